@@ -0,0 +1,102 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <cfloat>
+
+#include <glm.hpp>
+
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    AABB()
+        : min(glm::vec3(FLT_MAX)), max(glm::vec3(-FLT_MAX)) {
+    }
+
+    AABB(glm::vec3 min, glm::vec3 max)
+        : min(min), max(max) {
+    }
+
+    // Builds bounds from interleaved vertex data where each vertex starts with
+    // three position floats and vertices are `stride` floats apart.
+    static AABB FromPositions(const float *data, unsigned int count, unsigned int stride) {
+        AABB box;
+        for (unsigned int i = 0; i < count; i++) {
+            box.Expand(glm::vec3(data[i * stride], data[i * stride + 1], data[i * stride + 2]));
+        }
+        return box;
+    }
+
+    bool IsValid() const {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    void Expand(glm::vec3 point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Expand(const AABB &other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    glm::vec3 Center() const {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 Extents() const {
+        return (max - min) * 0.5f;
+    }
+
+    glm::vec3 Corner(int i) const {
+        return glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+    }
+
+    AABB Transform(const glm::mat4 &m) const {
+        AABB box;
+        for (int i = 0; i < 8; i++) {
+            box.Expand(glm::vec3(m * glm::vec4(Corner(i), 1.0f)));
+        }
+        return box;
+    }
+};
+
+struct Frustum {
+    // left, right, bottom, top, near, far; xyz points inwards
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4 &viewProjection) {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(viewProjection[0][i],
+                                viewProjection[1][i],
+                                viewProjection[2][i],
+                                viewProjection[3][i]);
+        }
+
+        for (int i = 0; i < 3; i++) {
+            planes[i * 2]     = rows[3] + rows[i];
+            planes[i * 2 + 1] = rows[3] - rows[i];
+        }
+
+        for (int i = 0; i < 6; i++) {
+            planes[i] /= glm::length(glm::vec3(planes[i]));
+        }
+    }
+
+    bool Intersects(const AABB &box) const {
+        for (int i = 0; i < 6; i++) {
+            glm::vec3 normal(planes[i]);
+            glm::vec3 positive(normal.x >= 0.0f ? box.max.x : box.min.x,
+                               normal.y >= 0.0f ? box.max.y : box.min.y,
+                               normal.z >= 0.0f ? box.max.z : box.min.z);
+            if (glm::dot(normal, positive) + planes[i].w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif // BOUNDS_H
@@ -47,6 +47,7 @@ class Camera {
         WorldUp  = up;
         Yaw      = yaw;
         Pitch    = pitch;
+        dirty    = true;
         updateCameraVectors();
     }
 
@@ -64,6 +65,7 @@ class Camera {
         WorldUp  = glm::vec3(upX, upY, upZ);
         Yaw      = yaw;
         Pitch    = pitch;
+        dirty    = true;
         updateCameraVectors();
     }
 
@@ -71,8 +73,24 @@ class Camera {
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // The current orientation seen from elsewhere, e.g. a position
+    // interpolated between simulation steps
+    glm::mat4 GetViewMatrix(const glm::vec3 &position) {
+        return glm::lookAt(position, position + Front, Up);
+    }
+
+    // Set by every Process* call that changes the view
+    bool IsDirty() const {
+        return dirty;
+    }
+
+    void ClearDirty() {
+        dirty = false;
+    }
+
     void ProcessKeyboard(Camera_Movement direction, float deltaTime) {
         float velocity = MovementSpeed * deltaTime;
+        dirty          = true;
         if (direction == FORWARD) {
             Position += Front * velocity;
         }
@@ -103,10 +121,13 @@ class Camera {
             }
         }
 
+        dirty = dirty || xOffset != 0.0f || yOffset != 0.0f;
         updateCameraVectors();
     }
 
     void ProcessMouseScroll(float yOffset) {
+        float zoom = Zoom;
+
         if (Zoom >= 1.0f && Zoom <= 45.0f) {
             Zoom -= yOffset;
         }
@@ -116,9 +137,12 @@ class Camera {
         if (Zoom >= 45.0f) {
             Zoom = 45.0f;
         }
+        dirty = dirty || Zoom != zoom;
     }
 
   private:
+    bool dirty;
+
     void updateCameraVectors() {
         glm::vec3 front;
         front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
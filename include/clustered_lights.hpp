@@ -0,0 +1,68 @@
+#ifndef CLUSTERED_LIGHTS_H
+#define CLUSTERED_LIGHTS_H
+
+#include <vector>
+
+#include <bounds.hpp>
+#include <lights.hpp>
+#include <shader.hpp>
+
+#include <glm.hpp>
+
+struct ClusterStats {
+    unsigned int lights;
+    unsigned int activeClusters;
+    unsigned int indices;
+    float        assignMs;
+};
+
+// Clustered forward lighting. The view frustum is split into screen tiles
+// and exponential depth slices. Every frame each point light is assigned on
+// the CPU to the clusters its influence sphere touches (SSE, four lights per
+// test), and the light data, per-cluster (offset, count) pairs and the flat
+// light index list are uploaded as texture buffers for
+// shaders/model/clustered.frag.
+class ClusteredLights {
+  public:
+    static const unsigned int ClustersX           = 16;
+    static const unsigned int ClustersY           = 9;
+    static const unsigned int ClustersZ           = 24;
+    static const unsigned int MaxLightsPerCluster = 128;
+
+    // Texture units the buffers are bound to, clear of the material textures
+    static const unsigned int LightDataUnit  = 5;
+    static const unsigned int ClusterUnit    = 6;
+    static const unsigned int LightIndexUnit = 7;
+
+    ClusteredLights(float near, float far);
+    ~ClusteredLights();
+
+    void Update(const std::vector<PointLight> &lights,
+                const glm::mat4               &view,
+                const glm::mat4               &projection);
+    void Bind(Shader &shader, int viewportWidth, int viewportHeight);
+
+    ClusterStats GetStats();
+
+  private:
+    float             near, far;
+    glm::mat4         projection;
+    std::vector<AABB> clusters;
+
+    // Per-slice candidate lights in SoA layout, padded to a multiple of four
+    std::vector<float>        sliceX[ClustersZ], sliceY[ClustersZ], sliceZ[ClustersZ];
+    std::vector<float>        sliceRadius2[ClustersZ];
+    std::vector<unsigned int> sliceLights[ClustersZ];
+
+    std::vector<glm::vec4>    lightData;
+    std::vector<unsigned int> grid;
+    std::vector<unsigned int> indices;
+
+    unsigned int buffers[3], textures[3];
+    ClusterStats stats;
+
+    void buildClusters(const glm::mat4 &projection);
+    int  slice(float depth);
+};
+
+#endif // CLUSTERED_LIGHTS_H
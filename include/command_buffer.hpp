@@ -0,0 +1,116 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <functional>
+#include <stddef.h>
+#include <vector>
+
+#include <texture.hpp>
+
+#include <glm.hpp>
+
+// One frame of rendering recorded as a compact byte stream and replayed
+// later by a backend (see RenderThread). Commands name programs, vertex
+// arrays and textures by handle and never call into GL, so a frame can be
+// recorded on one thread while another renders the previous one.
+//
+// Call() covers whatever the fixed commands do not. The callback runs on
+// the render thread after the recording thread has moved on, so it must
+// capture per-frame values by copy.
+class CommandBuffer {
+  public:
+    enum Type {
+        CLEAR,
+        VIEWPORT,
+        ENABLE,
+        DISABLE,
+        USE_PROGRAM,
+        SET_INT,
+        BIND_TEXTURE,
+        BIND_VERTEX_ARRAY,
+        UNIFORM_BLOCK,
+        DRAW_INDEXED,
+        PRESENT,
+        CALL
+    };
+
+    enum State {
+        CULL_FACE,
+        DEPTH_TEST,
+        BLEND
+    };
+
+    // Every command starts with a header, the payload follows. Sizes
+    // include the header and keep the next command 8-byte aligned.
+    struct Header {
+        unsigned int type;
+        unsigned int size;
+    };
+
+    // Payloads, variable-length data (names, block contents) follows them
+    struct ClearCommand {
+        float color[4];
+    };
+    struct ViewportCommand {
+        int x, y, width, height;
+    };
+    struct HandleCommand {
+        unsigned int handle;
+    };
+    struct IntCommand {
+        int          value;
+        unsigned int nameLength;
+    };
+    struct TextureCommand {
+        unsigned int unit;
+        Texture     *texture;
+    };
+    struct UniformBlockCommand {
+        unsigned int binding;
+        unsigned int size;
+    };
+    struct DrawCommand {
+        unsigned int count;
+        unsigned int firstIndex;
+    };
+
+    // Color and depth
+    void Clear(const glm::vec4 &color);
+    void Viewport(int x, int y, int width, int height);
+    void Enable(State state);
+    void Disable(State state);
+    void UseProgram(unsigned int program);
+    // Sets a uniform of the program from the last UseProgram()
+    void SetInt(const char *name, int value);
+    // The texture's ID is read at replay, so loads finishing in between count
+    void BindTexture(unsigned int unit, Texture *texture);
+    void BindVertexArray(unsigned int vertexArray);
+    // std140 data copied into the stream, bound by range at replay
+    void UniformBlock(unsigned int binding, const void *data, unsigned int size);
+    // Unsigned int indices of the bound vertex array
+    void DrawIndexed(unsigned int count, unsigned int firstIndex = 0);
+    void Present();
+    void Call(std::function<void()> callback);
+
+    void Reset();
+
+    // For backends: walks the stream from offset 0, false at the end
+    bool Next(size_t &offset, Header &header, const unsigned char *&payload) const;
+    void RunCall(const unsigned char *payload) const;
+
+    unsigned int GetCommandCount() const;
+    size_t       GetSize() const;
+
+  private:
+    std::vector<unsigned char>         bytes;
+    std::vector<std::function<void()>> callbacks;
+    unsigned int                       commands = 0;
+
+    void write(Type        type,
+               const void *payload,
+               size_t      payloadSize,
+               const void *extra     = NULL,
+               size_t      extraSize = 0);
+};
+
+#endif // COMMAND_BUFFER_H
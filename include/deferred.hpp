@@ -0,0 +1,49 @@
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+#include <vector>
+
+#include <framebuffer.hpp>
+#include <lights.hpp>
+#include <shader.hpp>
+
+#include <glm.hpp>
+
+// Deferred shading. Opaque geometry is written once into a compact G-buffer
+// (RGBA8 albedo + specular intensity, RGB10_A2 octahedral normal +
+// shininess, depth/stencil), then lit in screen space: the directional light
+// as a fullscreen pass and point lights as one instanced draw of sphere
+// volumes, so shading cost follows covered pixels rather than overdraw.
+class DeferredRenderer {
+  public:
+    DeferredRenderer(int width, int height);
+    ~DeferredRenderer();
+
+    void Resize(int width, int height);
+
+    // Binds and clears the G-buffer. Draw opaque geometry with the returned
+    // shader, which takes the same samplers and Transforms block as model.frag.
+    Shader &BeginGeometry(const glm::mat4 &view, const glm::mat4 &projection, float shininess);
+    void    EndGeometry();
+
+    // Lights the G-buffer into target, which also receives the G-buffer's
+    // depth so forward passes can draw on top. Blend, cull, depth and stencil
+    // state are restored afterwards.
+    void Light(Framebuffer                   &target,
+               const DirectionalLight        &directional,
+               const std::vector<PointLight> &pointLights,
+               const glm::vec3               &viewPos);
+
+  private:
+    Framebuffer            gbuffer;
+    Shader                 geometryPass, directionalPass, pointPass;
+    unsigned int           sphereVAO, sphereVBO, sphereEBO, instanceVBO, fullscreenVAO;
+    unsigned int           sphereIndexCount;
+    glm::mat4              view, projection;
+    std::vector<glm::vec4> instances;
+
+    void createSphere();
+    void bindGBuffer(Shader &shader);
+};
+
+#endif // DEFERRED_H
@@ -0,0 +1,89 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include <vector>
+
+#include <bounds.hpp>
+#include <shader.hpp>
+
+#include <glm.hpp>
+
+struct DepthPrepassStats {
+    unsigned int objects;
+    unsigned int prepassed;
+    // Fragments that passed the pre-pass depth test, i.e. what the main pass
+    // would have shaded for those objects without it
+    unsigned long long depthSamples;
+    // Fragments the main pass actually shaded for the pre-passed objects
+    unsigned long long shadedSamples;
+};
+
+// Depth-only pre-pass. Selected objects are first drawn with position-only
+// vertex data and an empty fragment shader, then shaded with depth writes off
+// and a GL_EQUAL (or GL_LEQUAL) test so every covered pixel is shaded once.
+//
+// Whether an object is worth it is decided per frame from its projected
+// screen coverage times its relative fragment cost, weighed against the cost
+// of transforming its triangles a second time.
+//
+// Sample counts come from GL_SAMPLES_PASSED queries read a few frames late,
+// so GetStats() describes a recent frame without ever stalling on the GPU.
+class DepthPrepass {
+  public:
+    enum Mode {
+        OFF,
+        EQUAL,
+        LEQUAL
+    };
+
+    DepthPrepass(Mode mode = EQUAL);
+    ~DepthPrepass();
+
+    unsigned int Add(const AABB &bounds, float shadingCost, unsigned int triangles);
+
+    void BeginDepthPass(const glm::mat4 &view, const glm::mat4 &projection);
+    // True when the object goes in the pre-pass. The depth program is bound
+    // with its transform set, the caller issues the position-only draw.
+    bool DrawDepth(unsigned int object, const glm::mat4 &model);
+    void EndDepthPass();
+
+    // Wrap an object's main pass draw, a no-op for objects not pre-passed
+    void BeginShading(unsigned int object);
+    void EndShading(unsigned int object);
+
+    void              SetMode(Mode mode);
+    Mode              GetMode();
+    DepthPrepassStats GetStats();
+
+  private:
+    struct Object {
+        AABB         bounds;
+        float        shadingCost;
+        unsigned int triangles;
+        bool         prepassed;
+    };
+
+    struct Frame {
+        unsigned int              depthQuery;
+        std::vector<unsigned int> shadingQueries;
+        unsigned int              used;
+        unsigned int              objects, prepassed;
+        bool                      pending;
+    };
+
+    static const unsigned int FrameLatency = 4;
+
+    Mode                mode;
+    Shader              depth;
+    std::vector<Object> objects;
+    Frame               frames[FrameLatency];
+    unsigned int        frame;
+    glm::mat4           view, projection;
+    DepthPrepassStats   stats;
+
+    bool         worthIt(const Object &object, const glm::mat4 &model);
+    void         collect(Frame &f);
+    unsigned int shadingQuery(Frame &f);
+};
+
+#endif // DEPTH_PREPASS_H
@@ -0,0 +1,120 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <bounds.hpp>
+#include <occlusion.hpp>
+#include <texture.hpp>
+
+#include <glm.hpp>
+
+struct DrawListStats {
+    unsigned int objects;
+    unsigned int visible;
+    unsigned int frustumCulled;
+    unsigned int occlusionCulled;
+    float        buildMs;
+    float        sortMs;
+};
+
+// One draw of the sorted list, in submission order
+struct DrawItem {
+    unsigned long long key;
+    unsigned int       vertexArray;
+    Texture           *texture;
+    unsigned int       indexCount;
+    unsigned int       prepass;
+    glm::mat4          model;
+};
+
+// Per-frame draw list for the simple textured objects. Build() culls the
+// objects and makes their sort keys in parallel over chunks of the scene;
+// each JobSystem worker appends to a list of its own, so the hot loop takes
+// no locks. The lists are then merged and radix sorted by key, again across
+// the workers, and only the GL submission of the result is left to the
+// caller.
+//
+// Opaque items sort first, grouped by vertex array and texture and front to
+// back within a group. Transparent items follow, back to front.
+class DrawList {
+  public:
+    enum Layer {
+        OPAQUE,
+        TRANSPARENT
+    };
+
+    // DrawItem::prepass for objects without a DepthPrepass entry
+    static const unsigned int NoPrepass = ~0u;
+
+    unsigned int Add(const AABB  &bounds,
+                     unsigned int vertexArray,
+                     Texture     *texture,
+                     unsigned int indexCount,
+                     Layer        layer   = OPAQUE,
+                     unsigned int prepass = NoPrepass);
+    void         SetTransform(unsigned int object, const glm::mat4 &model);
+    void         SetEnabled(unsigned int object, bool enabled);
+
+    // Objects outside the frustum are dropped, then those the culler (when
+    // given, rasterized for this frame) reports hidden
+    void Build(const glm::mat4 &viewProjection,
+               const glm::vec3 &viewPos,
+               OcclusionCuller *occlusion = NULL);
+
+    const std::vector<DrawItem> &GetItems() const;
+    // Items before this index are opaque
+    unsigned int  GetOpaqueCount() const;
+    DrawListStats GetStats() const;
+
+  private:
+    struct Object {
+        AABB         bounds;
+        glm::mat4    model;
+        unsigned int vertexArray;
+        Texture     *texture;
+        // Index into textures, grouped on instead of the GL name that the
+        // loader may still fill in
+        unsigned int material;
+        unsigned int indexCount;
+        unsigned int prepass;
+        Layer        layer;
+        bool         enabled;
+    };
+
+    // What each worker produced
+    struct Bucket {
+        std::vector<DrawItem> items;
+        unsigned int          frustumCulled;
+        unsigned int          occlusionCulled;
+    };
+
+    struct SortEntry {
+        unsigned long long key;
+        unsigned int       item;
+    };
+
+    // Objects per culling task, and at least this many entries per sort chunk
+    static const int ObjectGrain = 64;
+    static const int SortGrain   = 4096;
+
+    std::vector<Object>       objects;
+    std::vector<Texture *>    textures;
+    std::vector<Bucket>       buckets;
+    std::vector<DrawItem>     merged, items;
+    std::vector<SortEntry>    entries, scratch;
+    std::vector<unsigned int> histograms;
+    unsigned int              opaqueCount = 0;
+    DrawListStats             stats       = DrawListStats();
+
+    static unsigned long long sortKey(const Object &object, float distance);
+    void                      cull(int              first,
+                                   int              last,
+                                   const Frustum   &frustum,
+                                   const glm::vec3 &viewPos,
+                                   OcclusionCuller *occlusion);
+    void                      sort();
+};
+
+#endif // DRAW_LIST_H
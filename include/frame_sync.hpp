@@ -0,0 +1,45 @@
+#ifndef FRAME_SYNC_H
+#define FRAME_SYNC_H
+
+#include <glad/glad.h>
+
+struct FrameSyncStats {
+    unsigned int framesInFlight;
+    unsigned int frames;
+    unsigned int stalledFrames; // frames that had to wait for the GPU
+    float        lastWaitMs;
+    float        averageWaitMs;
+    float        maxWaitMs;
+};
+
+// Bounds how far the CPU runs ahead of the GPU. Each frame takes the next
+// of framesInFlight slots; BeginFrame() waits on the fence the slot's last
+// use left behind, so data a dynamic buffer keeps per slot is never
+// overwritten while the GPU may still read it. Time spent waiting is
+// tracked, a steady non-zero wait means the frame is GPU bound.
+class FrameSync {
+  public:
+    static const unsigned int MaxFramesInFlight = 4;
+
+    explicit FrameSync(unsigned int framesInFlight = 3);
+    ~FrameSync();
+
+    void BeginFrame();
+    // Fences the frame's commands, call after the last draw or swap
+    void EndFrame();
+
+    unsigned int   GetFramesInFlight();
+    unsigned int   GetSlot();
+    FrameSyncStats GetStats();
+    void           ResetStats();
+
+  private:
+    unsigned int framesInFlight;
+    unsigned int slot;
+    GLsync       fences[MaxFramesInFlight];
+
+    FrameSyncStats stats;
+    double         totalWaitMs;
+};
+
+#endif // FRAME_SYNC_H
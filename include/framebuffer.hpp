@@ -0,0 +1,37 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+// Offscreen render target with texture attachments so later passes can
+// sample what was rendered (depth in particular).
+class Framebuffer {
+  public:
+    Framebuffer(int width, int height, std::vector<GLenum> colorFormats, bool depth = true);
+    ~Framebuffer();
+
+    void Bind();
+    void Resize(int width, int height);
+    void BlitToDefault(int width, int height);
+
+    unsigned int GetID();
+    unsigned int GetColor(unsigned int index);
+    unsigned int GetDepth();
+    int          GetWidth();
+    int          GetHeight();
+
+  private:
+    unsigned int              id;
+    std::vector<unsigned int> colors;
+    std::vector<GLenum>       colorFormats;
+    unsigned int              depth;
+    bool                      hasDepth;
+    int                       width, height;
+
+    void create();
+    void destroy();
+};
+
+#endif // FRAMEBUFFER_H
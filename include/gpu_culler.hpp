@@ -0,0 +1,88 @@
+#ifndef GPU_CULLER_H
+#define GPU_CULLER_H
+
+#include <vector>
+
+#include <bounds.hpp>
+#include <hiz.hpp>
+#include <shader.hpp>
+
+#include <glm.hpp>
+
+// GPU-driven culling. Instance transforms and bounds live in an SSBO, a
+// compute shader tests them against the frustum and a Hi-Z pyramid and
+// compacts the survivors into per-draw ranges of an instance index buffer,
+// which one glMultiDrawElementsIndirect call then consumes.
+//
+// Cull() is a single pass against a pyramid from an earlier frame. The two
+// phase variant avoids its one-frame lag: CullEarly() selects what was
+// visible last frame, the caller draws it and rebuilds the pyramid, then
+// CullLate() tests everything against that pyramid, records visibility for
+// the next frame and selects only the newly disoccluded instances.
+//
+// Every draw must come from the same VAO. The visible instance index is fed
+// to the vertex shader through an instanced attribute (see BindInstanceAttribute)
+// and is used to look up the instance in the SSBO bound at InstanceBinding.
+class GpuCuller {
+  public:
+    static const unsigned int InstanceBinding = 0;
+
+    GpuCuller();
+    ~GpuCuller();
+
+    static bool IsSupported();
+
+    unsigned int AddDraw(unsigned int indexCount, unsigned int firstIndex, int baseVertex);
+    void         AddInstance(unsigned int draw, const glm::mat4 &model, const AABB &bounds);
+    void         Upload();
+
+    void BindInstanceAttribute(unsigned int vao, unsigned int location);
+    void Cull(const glm::mat4 &viewProjection,
+              HiZPyramid      *hiZ,
+              const glm::mat4 &hiZViewProjection);
+    void CullEarly(const glm::mat4 &viewProjection);
+    void CullLate(const glm::mat4 &viewProjection, HiZPyramid *hiZ);
+    void Draw();
+
+    unsigned int GetInstanceCount();
+    // Stalls on the GPU, meant for debugging and correctness checks
+    unsigned int ReadVisibleCount();
+
+  private:
+    enum Phase {
+        SINGLE,
+        EARLY,
+        LATE
+    };
+
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint  baseVertex;
+        GLuint baseInstance;
+    };
+
+    // std430 layout, mirrored in shaders/culling/cull.comp
+    struct Instance {
+        glm::mat4 model;
+        glm::vec4 boundsMin;
+        glm::vec4 boundsMax;
+        GLuint    draw;
+        GLuint    padding[3];
+    };
+
+    Shader                   cull;
+    std::vector<DrawCommand> draws;
+    std::vector<Instance>    instances;
+    unsigned int             instanceBuffer, visibilityBuffer, visibleBuffer;
+    unsigned int             drawTemplateBuffers[2], drawBuffers[2];
+    unsigned int             activeDraws;
+
+    void dispatch(Phase            phase,
+                  const glm::mat4 &viewProjection,
+                  HiZPyramid      *hiZ,
+                  const glm::mat4 &hiZViewProjection);
+};
+
+#endif // GPU_CULLER_H
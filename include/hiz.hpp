@@ -0,0 +1,31 @@
+#ifndef HIZ_H
+#define HIZ_H
+
+#include <shader.hpp>
+
+// Hierarchical-Z pyramid: an R32F mip chain where every texel holds the
+// farthest depth of the texels below it. Build() can run mid-frame: the
+// caller's framebuffer, viewport and depth/blend/cull state are restored, the
+// bound program and vertex array are not.
+class HiZPyramid {
+  public:
+    HiZPyramid(int width, int height);
+    ~HiZPyramid();
+
+    void Resize(int width, int height);
+    void Build(unsigned int depthTexture);
+
+    unsigned int GetTexture();
+    int          GetWidth();
+    int          GetHeight();
+    int          GetLevels();
+
+  private:
+    Shader       downsample;
+    unsigned int texture, framebuffer, vao;
+    int          width, height, levels;
+
+    void create();
+};
+
+#endif // HIZ_H
@@ -0,0 +1,114 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <work_stealing_deque.hpp>
+
+struct JobStats {
+    unsigned long long jobs;
+    unsigned long long steals;
+    unsigned long long failedSteals;
+    float              busyMs;
+    float              idleMs;
+};
+
+// Counts unfinished jobs. Jobs started with RunAfter() wait for one to
+// reach zero, Wait() blocks on one. Wait() on it before it is destroyed.
+class JobCounter {
+  public:
+    JobCounter();
+
+    int Get() const;
+
+  private:
+    struct Job;
+
+    std::atomic<int>   count;
+    std::atomic_flag   lock;
+    std::vector<Job *> waiting;
+
+    void acquire();
+    void release();
+
+    friend class JobSystem;
+};
+
+// Work-stealing job system. One worker per core: the thread calling Start()
+// is worker 0 and the others are spawned. Every worker owns a Chase-Lev
+// deque, runs its own newest job first and steals the oldest from a random
+// other worker when it runs out. Idle workers spin briefly, then sleep until
+// a job is queued.
+//
+// Jobs may be queued from any worker, including from inside a job. Other
+// threads (and everyone before Start()) run the job on the spot, so code
+// written against the job system works without it. Wait() runs other jobs
+// while it waits, so a job may wait on jobs it started.
+class JobSystem {
+  public:
+    // threads counts the calling thread, 0 means one per core. Pinning puts
+    // worker i on CPU i, where the platform supports it.
+    static void Start(unsigned int threads = 0, bool pin = false);
+    static void Stop();
+
+    static unsigned int GetWorkerCount();
+    // The calling thread's worker, -1 off the workers or before Start()
+    static int GetWorkerIndex();
+
+    static void Run(std::function<void()> work, JobCounter *counter = NULL);
+    // Queued once dependency reaches zero
+    static void RunAfter(JobCounter           &dependency,
+                         std::function<void()> work,
+                         JobCounter           *counter = NULL);
+    static void Wait(JobCounter &counter);
+
+    // body(first, last) over [begin, end) in ranges of at most grain, returns
+    // when all of them are done. Ranges are split in halves so thieves take
+    // large pieces.
+    static void ParallelFor(int                                  begin,
+                            int                                  end,
+                            int                                  grain,
+                            const std::function<void(int, int)> &body);
+
+    // Per worker, worker 0 only counts time spent in Wait()
+    static std::vector<JobStats> GetStats();
+    static void                  ResetStats();
+
+  private:
+    typedef JobCounter::Job Job;
+
+    struct Worker {
+        WorkStealingDeque<Job>          deque;
+        std::thread                     thread;
+        unsigned int                    random;
+        std::atomic<unsigned long long> jobs, steals, failedSteals, busyNs, idleNs;
+    };
+
+    // Spin this many empty rounds before sleeping
+    static const unsigned int SpinRounds = 64;
+
+    static std::vector<Worker *>   workers;
+    static std::atomic<bool>       running;
+    static std::atomic<int>        queued;
+    static std::atomic<int>        sleeping;
+    static std::mutex              sleepLock;
+    static std::condition_variable wake;
+
+    static void push(Job *job);
+    static Job *find(unsigned int index);
+    static void execute(Job *job, int index);
+    static void finish(JobCounter *counter);
+    static void run(unsigned int index);
+    static void parallelFor(int                                  first,
+                            int                                  last,
+                            int                                  grain,
+                            const std::function<void(int, int)> &body,
+                            JobCounter                          &counter);
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,78 @@
+#ifndef LIGHT_MANAGER_H
+#define LIGHT_MANAGER_H
+
+#include <utility>
+#include <vector>
+
+#include <bounds.hpp>
+#include <lights.hpp>
+#include <shader.hpp>
+
+#include <glm.hpp>
+
+struct LightManagerStats {
+    unsigned int objects;
+    unsigned int lightsTested;
+    unsigned int lightsAssigned;
+    float        assignMs;
+};
+
+// Owns the scene lights and hands every object its own short list of the
+// point lights that matter most to it. Lights are bucketed into a uniform
+// grid each Update(); an object only looks at the cells its bounding sphere
+// covers, tests those candidates four at a time and keeps the
+// MaxLightsPerObject brightest by attenuation at the sphere's surface.
+// Bind() uploads one object's list for shaders/model/lightlist.frag.
+class LightManager {
+  public:
+    static const unsigned int MaxLightsPerObject = 8;
+
+    LightManager(float cellSize = 8.0f);
+
+    void                     SetDirectionalLight(const DirectionalLight &light);
+    const DirectionalLight  &GetDirectionalLight();
+    unsigned int             AddPointLight(const PointLight &light);
+    std::vector<PointLight> &GetPointLights();
+
+    unsigned int AddObject(const AABB &bounds);
+    void         SetTransform(unsigned int object, const glm::mat4 &model);
+
+    void Update();
+    void Bind(Shader &shader, unsigned int object);
+
+    LightManagerStats GetStats();
+
+  private:
+    struct Object {
+        AABB                      bounds;
+        glm::vec3                 center;
+        float                     radius;
+        std::vector<unsigned int> lights;
+    };
+
+    float                   cellSize;
+    DirectionalLight        directional;
+    std::vector<PointLight> pointLights;
+    std::vector<Object>     objects;
+    LightManagerStats       stats;
+
+    // (cell key, light) pairs sorted by key, plus lights too big to bucket
+    std::vector<std::pair<unsigned long long, unsigned int>> grid;
+    std::vector<unsigned int>                                unbucketed;
+    std::vector<float>                                       radii;
+
+    // Per-object scratch: candidate lights in SoA layout, padded to four
+    std::vector<unsigned int>                   candidates, visited;
+    std::vector<float>                          candidateX, candidateY, candidateZ, candidateRange;
+    std::vector<float>                          constant, linear, quadratic, brightness;
+    std::vector<std::pair<float, unsigned int>> ranked;
+    std::vector<glm::vec4>                      packed;
+    unsigned int                                visitStamp;
+
+    void               buildGrid();
+    void               assign(Object &object);
+    void               addCandidate(unsigned int light);
+    unsigned long long cellKey(int x, int y, int z);
+};
+
+#endif // LIGHT_MANAGER_H
@@ -0,0 +1,44 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm.hpp>
+
+// Mirrors the light structs in shaders/model/model.frag
+struct PointLight {
+    glm::vec3 position;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    // Distance where the brightest channel drops below 1/256, past which the
+    // light is treated as having no influence
+    float Radius() const {
+        glm::vec3 peak      = glm::max(diffuse, specular);
+        float     brightest = std::max(std::max(peak.x, peak.y), peak.z);
+
+        if (quadratic <= 0.0f) {
+            return linear > 0.0f ? (256.0f * brightest - constant) / linear : 1e30f;
+        }
+
+        float c = constant - 256.0f * brightest;
+        return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+    }
+};
+
+struct DirectionalLight {
+    glm::vec3 direction;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+#endif // LIGHTS_H
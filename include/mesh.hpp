@@ -1,8 +1,10 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <memory>
 #include <vector>
 
+#include <bounds.hpp>
 #include <shader.hpp>
 #include <texture.hpp>
 
@@ -22,13 +24,28 @@ class Mesh {
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    AABB                 bounds;
 
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures);
     void Draw(Shader shader);
+    void DrawDepth();
+    void BindTextures(const Shader &shader);
+
+    // ShaderFeature bits the material needs, see shader_variants.hpp
+    unsigned int GetVariantFeatures();
 
   private:
-    unsigned int VAO, VBO, EBO;
-    void         setupMesh();
+    // Shared by copies, buffers made on the loader thread reach all of them.
+    // The vertex arrays stay 0, and draws are skipped, until then.
+    struct Buffers {
+        unsigned int VAO, VBO, EBO;
+        // Tightly packed positions for depth-only passes
+        unsigned int positionVAO, positionVBO;
+    };
+    std::shared_ptr<Buffers> buffers;
+
+    void        setupMesh();
+    static void setupVertexArrays(Buffers &buffers);
 };
 
 #endif // MESH_H
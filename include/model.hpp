@@ -1,7 +1,10 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <functional>
+
 #include <mesh.hpp>
+#include <shader_variants.hpp>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
@@ -9,21 +12,36 @@
 
 class Model {
   public:
-    Model(char *path) {
+    Model(const char *path) {
         loadModel(path);
     }
 
-    void Draw(Shader shader);
+    void                Draw(Shader shader);
+    void                Draw(ShaderVariants                     &variants,
+                             unsigned int                        key,
+                             const std::function<void(Shader &)> &setup);
+    void                DrawDepth();
+    AABB                GetBounds();
+    unsigned int        GetTriangleCount();
+    vector<Mesh>       &GetMeshes();
 
   private:
     vector<Texture> textures_loaded;
     vector<Mesh>    meshes;
     string          directory;
+    AABB            bounds;
 
     void            loadModel(string path);
-    void            processNode(aiNode *node, const aiScene *scene);
-    Mesh            processMesh(aiMesh *mesh, const aiScene *scene);
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName);
+    void            processNode(aiNode *node, const aiScene *scene, vector<aiMesh *> &sceneMeshes);
+    static void     processMesh(aiMesh               *mesh,
+                                vector<Vertex>       &vertices,
+                                vector<unsigned int> &indices);
+    static void     addTexturePaths(aiMaterial *mat, aiTextureType type, vector<string> &paths);
+    vector<Texture> loadMaterialTextures(aiMaterial           *mat,
+                                         aiTextureType         type,
+                                         string                typeName,
+                                         const vector<string> &paths,
+                                         vector<TextureImage> &images);
 };
 
 #endif
@@ -0,0 +1,65 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <atomic>
+#include <vector>
+
+#include <bounds.hpp>
+
+#include <glm.hpp>
+
+struct OcclusionStats {
+    unsigned int occluderTriangles;
+    unsigned int occludeesTested;
+    unsigned int occludeesCulled;
+    float        rasterizeMs;
+};
+
+// CPU occlusion culler. Simplified occluder meshes are rasterized into a small
+// depth buffer (nearest depth wins, four pixels per SSE op, tiles spread over
+// JobSystem workers) and occludee bounds are tested against it before drawing.
+class OcclusionCuller {
+  public:
+    OcclusionCuller(int width = 256, int height = 128);
+
+    void Begin(const glm::mat4 &viewProjection);
+    void AddOccluder(const float        *positions,
+                     unsigned int        vertexCount,
+                     unsigned int        stride,
+                     const unsigned int *indices,
+                     unsigned int        indexCount,
+                     const glm::mat4    &model);
+    void Rasterize();
+    // Safe to call from several threads once Rasterize() has returned
+    bool IsVisible(const AABB &bounds, const glm::mat4 &model);
+
+    int            GetWidth() const;
+    int            GetHeight() const;
+    const float   *GetDepth() const;
+    OcclusionStats GetStats() const;
+
+  private:
+    struct Triangle {
+        glm::vec3 v[3];
+        int       minX, minY, maxX, maxY;
+    };
+
+    static const int TileWidth  = 32;
+    static const int TileHeight = 16;
+
+    int                    width, height;
+    int                    tilesX, tilesY;
+    glm::mat4              viewProjection;
+    std::vector<float>     depth;
+    std::vector<Triangle>  triangles;
+    std::vector<glm::vec4> clipped;
+    OcclusionStats         stats;
+
+    // IsVisible() runs on job workers
+    std::atomic<unsigned int> tested, culled;
+
+    void rasterizeTile(int tile);
+    void rasterizeTriangle(const Triangle &tri, int x0, int y0, int x1, int y1);
+};
+
+#endif // OCCLUSION_H
@@ -0,0 +1,83 @@
+#ifndef OCCLUSION_QUERY_H
+#define OCCLUSION_QUERY_H
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <bounds.hpp>
+#include <shader.hpp>
+
+#include <glm.hpp>
+
+struct OcclusionQueryStats {
+    unsigned int queriesIssued;
+    unsigned int drawsSkipped;
+    unsigned int poolSize;
+};
+
+// Hardware occlusion queries for expensive objects. An object's bounding box
+// is drawn as a proxy inside a GL_ANY_SAMPLES_PASSED query, after the
+// occluders. CONDITIONAL hands that query to glBeginConditionalRender so the
+// GPU drops the real draw without any readback. TEMPORAL instead reuses the
+// newest result that is already available from earlier frames and never
+// waits, at the cost of a frame or two of latency when an object reappears.
+// Only TEMPORAL skips are visible to the CPU and counted in drawsSkipped.
+class OcclusionQueries {
+  public:
+    enum Mode {
+        CONDITIONAL,
+        TEMPORAL
+    };
+
+    OcclusionQueries(Mode mode = CONDITIONAL);
+    ~OcclusionQueries();
+
+    unsigned int Add(const AABB &bounds);
+    void         BeginFrame();
+
+    // `draw` issues the real draw and must bind its own program
+    void Draw(unsigned int                 object,
+              const glm::mat4             &model,
+              const glm::mat4             &view,
+              const glm::mat4             &projection,
+              const std::function<void()> &draw);
+
+    void                SetMode(Mode mode);
+    Mode                GetMode();
+    OcclusionQueryStats GetStats();
+
+  private:
+    struct Object {
+        AABB                     bounds;
+        bool                     visible;
+        std::deque<unsigned int> pending;
+    };
+
+    struct Retired {
+        unsigned int query;
+        unsigned int frame;
+    };
+
+    // Frames before a query used for conditional rendering is handed out again
+    static const unsigned int Latency = 3;
+    // Temporal queries in flight per object
+    static const unsigned int MaxPending = 3;
+
+    Mode                      mode;
+    Shader                    proxy;
+    unsigned int              vao, vbo, ebo;
+    unsigned int              frame;
+    std::vector<Object>       objects;
+    std::vector<unsigned int> freeQueries;
+    std::deque<Retired>       retired;
+    OcclusionQueryStats       stats;
+
+    unsigned int acquire();
+    void         drawProxy(const AABB      &bounds,
+                           const glm::mat4 &model,
+                           const glm::mat4 &view,
+                           const glm::mat4 &projection);
+};
+
+#endif // OCCLUSION_QUERY_H
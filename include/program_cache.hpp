@@ -0,0 +1,35 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// On-disk cache of linked program binaries. Entries are keyed by a hash of
+// the final stage sources (preamble included) and the driver's vendor,
+// renderer and version strings, so a driver update simply misses. Every
+// failure - no support, no file, a binary the driver rejects - is silent and
+// leaves the caller to compile from source.
+class ProgramCache {
+  public:
+    // An empty directory turns the cache off
+    static void SetDirectory(const std::string &directory);
+
+    static std::string Key(const std::vector<std::string> &sources);
+    static bool        Load(unsigned int program, const std::string &key);
+    static void        SetRetrievable(unsigned int program);
+    static void        Save(unsigned int program, const std::string &key);
+
+    static unsigned int GetHits();
+    static unsigned int GetMisses();
+
+  private:
+    static std::string  directory;
+    static unsigned int hits, misses;
+
+    static bool        isSupported();
+    static std::string path(const std::string &key);
+};
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,79 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <SDL.h>
+
+#include <command_buffer.hpp>
+#include <ring_buffer.hpp>
+
+struct RenderThreadStats {
+    unsigned int frames;
+    // Last frame's stream
+    unsigned int commands;
+    size_t       bytes;
+    // Totals: the simulation blocked in Submit(), the render thread replaying
+    // and the render thread waiting for a frame
+    float submitWaitMs;
+    float replayMs;
+    float idleMs;
+};
+
+// Owns the GL context on a thread of its own and replays CommandBuffers
+// into GL. Two buffers alternate: the simulation records frame N+1 into one
+// while the render thread replays frame N from the other. Submit() is the
+// hand-off; it waits for frame N to finish, so the simulation is never more
+// than one frame ahead.
+//
+// Once started, GL is only called from the render thread; everything else
+// goes through the command stream, including CommandBuffer::Call().
+//
+// Should the context fail to become current on the new thread, the
+// constructor takes it back and Submit() replays on the calling thread.
+class RenderThread {
+  public:
+    // The context is released from the calling thread and made current on
+    // the render thread, returns once that either worked or the context is
+    // current on the caller again. drawData backs UniformBlock commands.
+    RenderThread(SDL_Window *window, SDL_GLContext context, RingBuffer &drawData);
+    ~RenderThread();
+
+    // The buffer being recorded, empty at the start of each frame
+    CommandBuffer &GetCommands();
+    void           Submit();
+
+    // Finishes the frame being replayed, drops anything not yet replayed and
+    // makes the context current on the calling thread again
+    void Stop();
+
+    RenderThreadStats GetStats();
+    void              ResetStats();
+
+  private:
+    SDL_Window   *window;
+    SDL_GLContext context;
+    RingBuffer   &drawData;
+
+    CommandBuffer  buffers[2];
+    unsigned int   recording;
+    CommandBuffer *pending;
+    bool           replaying, stopping;
+    // The thread reported back, and whether it owns the context
+    bool           started, threaded;
+
+    std::mutex              lock;
+    std::condition_variable changed;
+    std::thread             thread;
+    RenderThreadStats       stats;
+
+    // Replay state
+    unsigned int program;
+
+    void run();
+    void replay(const CommandBuffer &commands);
+};
+
+#endif // RENDER_THREAD_H
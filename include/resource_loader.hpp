@@ -0,0 +1,64 @@
+#ifndef RESOURCE_LOADER_H
+#define RESOURCE_LOADER_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <thread>
+
+#include <SDL.h>
+#include <glad/glad.h>
+
+#include <spsc_queue.hpp>
+
+// Optional loader thread with its own GL context, shared with the main one
+// (SDL_GL_SHARE_WITH_CURRENT_CONTEXT), so decoding and creating textures and
+// buffers does not compete with rendering. Work is handed over through a
+// lock-free queue and runs on the loader thread in order; each job is fenced
+// and its onReady runs from Poll() on the main thread once the GPU has
+// finished the job's commands. Objects are visible to the main context from
+// then on, provided onReady (or the next draw) binds them again.
+//
+// Only shared objects - buffers, textures, programs - may be created by
+// work. Container objects such as vertex arrays belong to one context and
+// are made in onReady.
+class ResourceLoader {
+  public:
+    // Call with the main context current. False when the shared context or
+    // the thread cannot be created, or the context cannot be made current on
+    // the thread; callers then load on the main thread.
+    static bool Start(SDL_Window *window);
+    static void Stop();
+    static bool IsRunning();
+
+    static void Queue(std::function<void()> work, std::function<void()> onReady);
+
+    // Once per frame, runs onReady for finished jobs
+    static void Poll();
+
+    static unsigned int GetPendingCount();
+    static unsigned int GetCompletedCount();
+
+  private:
+    struct Job {
+        std::function<void()> work;
+        std::function<void()> onReady;
+        GLsync                 fence;
+    };
+
+    static SDL_Window       *window;
+    static SDL_GLContext     context;
+    static SDL_sem          *wake;
+    static std::thread       thread;
+    static std::atomic<bool> running;
+
+    // Main -> loader, and finished jobs back
+    static SpscQueue<Job *> requests, results;
+    // Finished on the loader, main thread still waiting on their fences
+    static std::deque<Job *> fenced;
+    static unsigned int      queued, completed;
+
+    static void run(SDL_sem *ready);
+};
+
+#endif // RESOURCE_LOADER_H
@@ -0,0 +1,54 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <frame_sync.hpp>
+
+// Per-draw dynamic data (uniform blocks, instance data) written straight
+// into GPU memory. The buffer holds one region per FrameSync slot and is
+// mapped once, persistently and coherently, so an allocation is a pointer
+// bump and the write a memcpy. FrameSync's fences keep the CPU from
+// overwriting a region the GPU is still reading.
+//
+// Without ARB_buffer_storage the buffer is a single region orphaned every
+// frame; allocations land in CPU memory and BindRange() uploads what was
+// written since the last bind.
+class RingBuffer {
+  public:
+    RingBuffer(GLenum target, GLsizeiptr frameSize, FrameSync &sync);
+    ~RingBuffer();
+
+    // Switches to the current slot's region, call after FrameSync::BeginFrame
+    void BeginFrame();
+
+    // Room for size bytes, aligned for binding. NULL once the frame's
+    // region is full.
+    void *Allocate(GLsizeiptr size, GLintptr &offset);
+
+    // For indexed targets: uniform, shader storage
+    void BindRange(unsigned int index, GLintptr offset, GLsizeiptr size);
+
+    unsigned int GetID();
+    bool         IsPersistent();
+
+  private:
+    GLenum         target;
+    unsigned int   buffer;
+    GLsizeiptr     frameSize;
+    GLintptr       alignment;
+    FrameSync     &sync;
+    unsigned int   frame;
+    GLintptr       head;
+    bool           persistent;
+    bool           overflowed;
+    unsigned char *mapped;
+
+    // Fallback path
+    std::vector<unsigned char> shadow;
+    GLintptr                   uploaded;
+};
+
+#endif // RING_BUFFER_H
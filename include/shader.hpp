@@ -4,79 +4,71 @@
 #include <glad/glad.h>
 #include <glm.hpp>
 
-#include <fstream>
+#include <program_cache.hpp>
+#include <shader_source.hpp>
+#include <uniform_blocks.hpp>
+
 #include <iostream>
-#include <sstream>
 #include <string>
 
 class Shader {
   public:
     unsigned int ID;
 
-    Shader(const GLchar *vertexPath, const GLchar *fragmentPath) {
-        std::string   vertexCode;
-        std::string   fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-        try {
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
+    Shader(const GLchar *vertexPath, const GLchar *fragmentPath)
+        : Shader(vertexPath, fragmentPath, "") {
+    }
 
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
+    // The preamble (usually #defines) is placed right after each stage's
+    // #version line. Sources are loaded through ShaderSource, so #include
+    // works and stage objects are shared with identical programs.
+    Shader(const GLchar *vertexPath, const GLchar *fragmentPath, const std::string &preamble) {
+        std::string vertexCode   = injectPreamble(ShaderSource::Load(vertexPath), preamble);
+        std::string fragmentCode = injectPreamble(ShaderSource::Load(fragmentPath), preamble);
 
-            vShaderFile.close();
-            fShaderFile.close();
+        ID = glCreateProgram();
 
-            vertexCode   = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        } catch (std::ifstream::failure e) {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+        std::string cacheKey = ProgramCache::Key({vertexCode, fragmentCode});
+        if (ProgramCache::Load(ID, cacheKey)) {
+            BindUniformBlocks(ID);
+            return;
         }
 
-        const char *vShaderCode = vertexCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
+        unsigned int vertex   = compile(GL_VERTEX_SHADER, vertexCode, "VERTEX");
+        unsigned int fragment = compile(GL_FRAGMENT_SHADER, fragmentCode, "FRAGMENT");
 
-        unsigned int vertex, fragment;
-        int          success;
-        char         infoLog[512];
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        ProgramCache::SetRetrievable(ID);
+        link();
+        ProgramCache::Save(ID, cacheKey);
 
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
+        ShaderSource::ReleaseStage(vertex);
+        ShaderSource::ReleaseStage(fragment);
+        BindUniformBlocks(ID);
+    }
 
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
+    // Compute programs need a 4.3 context
+    explicit Shader(const GLchar *computePath) {
+        std::string computeCode = ShaderSource::Load(computePath);
 
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
 
-        glGetProgramiv(ID, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(ID, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        std::string cacheKey = ProgramCache::Key({computeCode});
+        if (ProgramCache::Load(ID, cacheKey)) {
+            BindUniformBlocks(ID);
+            return;
         }
 
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        unsigned int compute = compile(GL_COMPUTE_SHADER, computeCode, "COMPUTE");
+
+        glAttachShader(ID, compute);
+        ProgramCache::SetRetrievable(ID);
+        link();
+        ProgramCache::Save(ID, cacheKey);
+
+        ShaderSource::ReleaseStage(compute);
+        BindUniformBlocks(ID);
     }
 
     void use() {
@@ -95,7 +87,7 @@ class Shader {
         glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
     }
 
-    void setVec2(const std::string &name, glm::vec2 &value) const {
+    void setVec2(const std::string &name, const glm::vec2 &value) const {
         glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
     }
 
@@ -119,17 +111,76 @@ class Shader {
         glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
     }
 
-    void setMat2(const std::string &name, glm::mat2 &mat) const {
+    void setMat2(const std::string &name, const glm::mat2 &mat) const {
         glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
 
-    void setMat3(const std::string &name, glm::mat3 &mat) const {
+    void setMat3(const std::string &name, const glm::mat3 &mat) const {
         glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
 
-    void setMat4(const std::string &name, glm::mat4 &mat) const {
+    void setMat4(const std::string &name, const glm::mat4 &mat) const {
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
+
+  private:
+    static std::string injectPreamble(const std::string &code, const std::string &preamble) {
+        if (preamble.empty() || code.compare(0, 8, "#version") != 0) {
+            return code;
+        }
+
+        // #line keeps compiler messages pointing at the lines in the file
+        std::string::size_type end = code.find('\n');
+        if (end == std::string::npos) {
+            return code + "\n" + preamble;
+        }
+        return code.substr(0, end + 1) + preamble + "#line 2\n" + code.substr(end + 1);
+    }
+
+    static unsigned int compile(GLenum type, const std::string &code, const char *stage) {
+        unsigned int shader = ShaderSource::AcquireStage(type, code);
+        checkCompile(shader, stage);
+        return shader;
+    }
+
+    static bool checkCompile(unsigned int shader, const char *stage) {
+        int  success;
+        char infoLog[512];
+
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::" << stage << "::COMPILATION_FAILED\n"
+                      << infoLog << std::endl;
+        }
+
+        return success;
+    }
+
+    static bool checkLink(unsigned int program) {
+        int  success;
+        char infoLog[512];
+
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+
+        return success;
+    }
+
+    void link() {
+        glLinkProgram(ID);
+        checkLink(ID);
+    }
+
+    // Programs built by ShaderManager are wrapped after the fact
+    Shader() {
+        ID = 0;
+    }
+
+    friend class ShaderManager;
 };
 
 #endif
@@ -0,0 +1,91 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <shader.hpp>
+
+// Builds programs without blocking the frame. Submit() hands all compiles
+// to the driver up front; Poll() moves programs on to linking and then to
+// ready as the driver reports them finished, which with
+// KHR_parallel_shader_compile never waits. Until a program is ready Get()
+// returns the fallback program, so callers can draw from the first frame.
+// Without the extension Poll() finishes a couple of programs per call,
+// spreading the stalls over several frames instead of one long startup.
+//
+// With WatchForChanges() (inotify, Linux only) editing a source file
+// rebuilds just the programs that read it. A rebuilt program replaces the
+// old one inside Poll(), so call it once per frame before drawing; if the
+// new source does not compile the old program stays in use.
+class ShaderManager {
+  public:
+    static const unsigned int MaxBlockingPerPoll = 2;
+
+    // The fallback is built synchronously and must accept the same vertex
+    // layout as the programs it stands in for
+    ShaderManager(const char *fallbackVertexPath, const char *fallbackFragmentPath);
+    ~ShaderManager();
+
+    // onReady runs from Poll() with the program bound, again after every
+    // reload since a new program starts without uniforms
+    unsigned int Submit(const char                          *vertexPath,
+                        const char                          *fragmentPath,
+                        const std::string                   &preamble = "",
+                        const std::function<void(Shader &)> &onReady  = nullptr);
+    void         Poll();
+
+    // False where file watching is unsupported
+    bool WatchForChanges();
+
+    bool         IsReady(unsigned int program);
+    Shader      &Get(unsigned int program);
+    Shader      &GetFallback();
+    unsigned int GetPendingCount();
+    unsigned int GetReloadCount();
+    bool         IsParallel();
+
+  private:
+    enum State {
+        COMPILING,
+        LINKING,
+        READY,
+        FAILED
+    };
+
+    struct Program {
+        State                         state;
+        bool                          live; // shaders[i] holds a linked program
+        unsigned int                  building;
+        unsigned int                  vertex, fragment;
+        bool                          cached;
+        std::string                   cacheKey;
+        std::string                   vertexPath, fragmentPath, preamble;
+        std::vector<std::string>      files;
+        std::function<void(Shader &)> onReady;
+    };
+
+    Shader              fallback;
+    std::deque<Program> programs;
+    std::deque<Shader>  shaders;
+    unsigned int        pending;
+    unsigned int        reloads;
+    bool                parallel;
+
+    int                        watchFd;
+    std::map<int, std::string> watchedDirectories;
+    std::map<std::string, int> directoryWatches;
+
+    void build(unsigned int index);
+    void cancel(unsigned int index);
+    void watch(const std::string &path);
+    void readChanges(std::set<std::string> &changed);
+    bool isComplete(unsigned int object, bool isProgram);
+    void finish(unsigned int index, bool linked);
+};
+
+#endif // SHADER_MANAGER_H
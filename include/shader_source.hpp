@@ -0,0 +1,65 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// GLSL loading shared by every program. Files are read once and kept in
+// memory, as is each file's expanded source. A line
+//
+//     #include "relative/path.glsl"
+//
+// is replaced with that file, resolved against the including file's
+// directory. Each file is inlined at most once per expanded source, which
+// doubles as its include guard; #line directives keep compiler messages on
+// the right line, with the source string number giving the file's position
+// in the dependency list.
+//
+// Compiled stage objects are shared too: programs whose stage code is
+// identical, preamble included, attach the same shader object. Stages stay
+// around for reuse until Trim() drops the ones no program is building with.
+class ShaderSource {
+  public:
+    // files receives path followed by every file it includes
+    static std::string Load(const std::string &path, std::vector<std::string> *files = NULL);
+
+    // Forgets path and every expanded source that included it
+    static void Invalidate(const std::string &path);
+
+    // The returned stage may still be compiling, check its status as usual
+    static unsigned int AcquireStage(GLenum type, const std::string &code);
+    static void         ReleaseStage(unsigned int stage);
+    static void         Trim();
+
+    static unsigned int GetFileReads();
+    static unsigned int GetStageCompiles();
+    static unsigned int GetStageReuses();
+
+  private:
+    struct Expanded {
+        std::string              code;
+        std::vector<std::string> files;
+    };
+
+    struct Stage {
+        unsigned int id;
+        unsigned int refs;
+    };
+
+    static std::map<std::string, std::string>  fileCache;
+    static std::map<std::string, Expanded>     expandedCache;
+    static std::map<std::string, Stage>        stages;
+    static std::map<unsigned int, std::string> stageKeys;
+    static unsigned int                        fileReads, stageCompiles, stageReuses;
+
+    static const std::string &read(const std::string &path);
+    static bool               expand(const std::string        &path,
+                                     std::vector<std::string> &files,
+                                     std::string              &code);
+    static std::string        normalize(const std::string &path);
+};
+
+#endif // SHADER_SOURCE_H
@@ -0,0 +1,60 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <shader.hpp>
+#include <shader_manager.hpp>
+
+// Feature bits of a variant key. The point light count takes bits 8-11.
+enum ShaderFeature {
+    VARIANT_SPECULAR_MAP = 1 << 0, // sample texture_specular1, else no specular term
+    VARIANT_ALPHA_TEST   = 1 << 1, // discard texels with diffuse alpha below 0.5
+    VARIANT_INSTANCED    = 1 << 2, // per-instance model matrix at locations 3-6
+    VARIANT_POSITION_UV  = 1 << 3, // vertex format without normals, uv at location 1
+};
+
+// Compiles specializations of one vertex/fragment source pair on demand.
+// A key's bits become a #define preamble (SHADER_VARIANTS, HAS_SPECULAR_MAP,
+// ALPHA_TEST, INSTANCED, VERTEX_POSITION_UV, POINT_LIGHT_COUNT n) so the
+// sources can compile out whatever a material does not use. Programs are
+// cached by key for the lifetime of the object.
+//
+// Given a ShaderManager, variants are built asynchronously instead: Get()
+// submits unknown keys and returns the manager's fallback until the variant
+// is ready, and Prewarm() submits the keys a scene is known to need up front.
+class ShaderVariants {
+  public:
+    static const unsigned int FeatureMask    = 0xFF;
+    static const unsigned int PointLightBits = 8;
+    static const unsigned int MaxPointLights = 15;
+
+    ShaderVariants(const char *vertexPath, const char *fragmentPath);
+    ShaderVariants(const char *vertexPath, const char *fragmentPath, ShaderManager *manager);
+    ~ShaderVariants();
+
+    static unsigned int Key(unsigned int features, unsigned int pointLights);
+    static std::string  Preamble(unsigned int key);
+
+    // Called once on every newly compiled program, for uniforms that never
+    // change such as lights or sampler units
+    void SetInitializer(const std::function<void(Shader &)> &initializer);
+
+    void         Prewarm(const std::vector<unsigned int> &keys);
+    Shader      &Get(unsigned int key);
+    unsigned int GetCompiledCount();
+
+  private:
+    std::string                          vertexPath, fragmentPath;
+    std::map<unsigned int, Shader *>     programs;
+    std::map<unsigned int, unsigned int> submitted;
+    std::function<void(Shader &)>        initializer;
+    ShaderManager                       *manager;
+
+    unsigned int submit(unsigned int key);
+};
+
+#endif // SHADER_VARIANTS_H
@@ -0,0 +1,62 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+// Unbounded lock-free queue for exactly one producer thread and one consumer
+// thread. Push() and Pop() never block; the head node is a stub whose value
+// has already been taken, so T must be default constructible.
+template <typename T> class SpscQueue {
+  public:
+    SpscQueue() {
+        head = tail = new Node();
+    }
+
+    ~SpscQueue() {
+        while (head) {
+            Node *next = head->next.load(std::memory_order_relaxed);
+            delete head;
+            head = next;
+        }
+    }
+
+    SpscQueue(const SpscQueue &)            = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Producer only
+    void Push(const T &value) {
+        Node *node  = new Node();
+        node->value = value;
+        tail->next.store(node, std::memory_order_release);
+        tail = node;
+    }
+
+    // Consumer only, false when empty
+    bool Pop(T &value) {
+        Node *next = head->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = next->value;
+        delete head;
+        head = next;
+        return true;
+    }
+
+  private:
+    struct Node {
+        T                   value;
+        std::atomic<Node *> next;
+
+        Node() : value(), next(NULL) {
+        }
+    };
+
+    // Consumer side
+    Node *head;
+    // Producer side
+    Node *tail;
+};
+
+#endif // SPSC_QUEUE_H
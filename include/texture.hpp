@@ -1,21 +1,37 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <memory>
 #include <string>
 
+// Pixels straight from stb_image, see Texture::Decode
+struct TextureImage {
+    unsigned char *pixels;
+    int            width, height, channels;
+};
+
+// Copies share the GL texture, it is deleted with the last copy
 class Texture {
   private:
-    unsigned int id;
-    std::string  type;
-    std::string  path;
+    std::shared_ptr<unsigned int> id;
+    std::string                   type;
+    std::string                   path;
+    int                           channels;
+
+    void create(TextureImage &image);
 
   public:
     Texture(std::string path, std::string type);
-    ~Texture();
+    // From pixels decoded ahead of time, the texture frees them
+    Texture(std::string path, std::string type, TextureImage image);
+
+    // No GL calls, so it can run on any thread (see Model)
+    static TextureImage Decode(const std::string &path);
 
     unsigned int GetID();
     std::string  GetType();
     std::string  GetPath();
+    bool         HasAlpha();
 };
 
 #endif // TEXTURE_H
@@ -0,0 +1,55 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+#include <SDL.h>
+
+// Fixed-rate simulation clock on SDL's performance counter. Advance() adds
+// the real time since the last call and Step() then hands out whole steps
+// until less than one is left, so the simulation always integrates with the
+// same step whatever the frame rate. GetAlpha() is where the render frame
+// sits between the last two simulation states.
+//
+// Time is kept in counter ticks, so the steps a given stretch of real time
+// produces never depend on float rounding.
+class FixedTimestep {
+  public:
+    explicit FixedTimestep(float rate = 60.0f);
+
+    void Advance();
+    bool Step();
+    // Drops the time since the last call, e.g. after sleeping while idle
+    void Reset();
+
+    // Seconds per step
+    float GetStep() const;
+    float GetAlpha() const;
+    // Simulated seconds, the sum of all steps taken
+    double GetTime() const;
+
+  private:
+    // Frames longer than this (a breakpoint, a stall) are not caught up on
+    static const unsigned int MaxSteps = 8;
+
+    Uint64             frequency;
+    Uint64             step;
+    Uint64             last;
+    Uint64             accumulator;
+    unsigned long long steps;
+};
+
+// Caps the render rate. Wait() returns at the next frame boundary, sleeping
+// through most of the gap and spinning the last millisecond.
+class FrameLimiter {
+  public:
+    // 0 means uncapped
+    explicit FrameLimiter(float rate = 0.0f);
+
+    void Wait();
+
+  private:
+    Uint64 frequency;
+    Uint64 interval;
+    Uint64 next;
+};
+
+#endif // TIMESTEP_H
@@ -0,0 +1,88 @@
+#ifndef UPLOAD_MANAGER_H
+#define UPLOAD_MANAGER_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Moves texture and buffer data to the GPU through a pool of staging
+// buffers instead of client memory. Stage() hands out mapped staging memory
+// for the caller to fill; the Copy functions then record GPU-side copies
+// (glTexSubImage2D from the buffer bound as a PBO, glCopyBufferSubData)
+// which the driver runs without waiting on the CPU. Submit() fences the
+// staging buffer, Poll() returns it to the pool once the GPU is done.
+//
+// Consecutive Stage() calls are carved out of the same open buffer while it
+// has room, so a model's meshes and textures share a few buffers rather
+// than taking one each. The buffer stays open until Submit(), which the
+// caller makes once every copy queued from it has run.
+//
+// Staging buffers are persistently mapped with ARB_buffer_storage and
+// mapped per use otherwise.
+class UploadManager {
+  public:
+    // Staging buffers are at least this big so small uploads share them
+    static const GLsizeiptr MinStagingSize = 4 * 1024 * 1024;
+    // Stage() offsets are aligned to this
+    static const GLintptr StagingAlignment = 16;
+    // Idle buffers beyond this are freed by Poll()
+    static const unsigned int MaxIdleStaging = 4;
+
+    // Mapped memory for size bytes, staging identifies the buffer in the
+    // calls below and offset is where the memory starts in it
+    static void *Stage(GLsizeiptr size, unsigned int &staging, GLintptr &offset);
+
+    static void CopyToBuffer(unsigned int staging,
+                             GLintptr     stagingOffset,
+                             unsigned int buffer,
+                             GLintptr     offset,
+                             GLsizeiptr   size);
+    // Rows are tightly packed, format is the client format (GL_RGB, ...).
+    // height rows starting at yOffset, so a texture can arrive in pieces.
+    static void CopyToTexture(unsigned int staging,
+                              GLintptr     stagingOffset,
+                              unsigned int texture,
+                              int          level,
+                              GLenum       format,
+                              int          width,
+                              int          height,
+                              int          yOffset = 0);
+
+    // Every copy from staging was made, it is reused once the GPU has read it
+    static void Submit(unsigned int staging);
+    static void Poll();
+
+    // Immutable storage where supported, plain allocations otherwise. Only
+    // GL calls, so ResourceLoader work can use them on its own context.
+    static void AllocateBuffer(unsigned int buffer, GLsizeiptr size, const void *data = NULL);
+    static void AllocateTexture(unsigned int texture,
+                                GLenum       internalFormat,
+                                int          width,
+                                int          height,
+                                int          levels);
+
+    static unsigned int GetInFlightCount();
+    static GLsizeiptr   GetStagedBytes();
+
+  private:
+    struct Staging {
+        unsigned int buffer;
+        GLsizeiptr   capacity;
+        // Bytes handed out since the buffer was last reused
+        GLintptr     used;
+        void        *mapped;
+        GLsync       fence;
+        // Open for Stage() until Submit()
+        bool         inUse;
+    };
+
+    static std::vector<Staging> pool;
+    static GLsizeiptr           stagedBytes;
+
+    static GLintptr alignUp(GLintptr offset);
+    static bool     isPersistent();
+    static void unmap(Staging &staging);
+};
+
+#endif // UPLOAD_MANAGER_H
@@ -0,0 +1,79 @@
+#ifndef UPLOAD_SCHEDULER_H
+#define UPLOAD_SCHEDULER_H
+
+#include <deque>
+#include <functional>
+#include <map>
+
+#include <glad/glad.h>
+
+struct UploadStats {
+    unsigned int queuedUploads;
+    GLsizeiptr   queuedBytes;
+    GLsizeiptr   bytesLastFrame;
+    float        msLastFrame;
+    // Frames the queue has been draining, and how long the last full drain took
+    unsigned int drainingFrames;
+    unsigned int lastDrainFrames;
+};
+
+// Spreads staged copies (see UploadManager) over frames. Queued copies run
+// highest priority first from Drain(), which stops at the per-frame byte or
+// time budget, whichever comes first. Textures are cut into row ranges and
+// buffers into byte ranges so one large asset never takes a whole frame;
+// a texture's mipmaps are generated once its last rows are in. Until then
+// its contents are undefined, so queue geometry at a higher priority.
+class UploadScheduler {
+  public:
+    enum Priority {
+        LOW    = 0,
+        NORMAL = 1,
+        HIGH   = 2
+    };
+
+    static void SetBudget(GLsizeiptr bytesPerFrame, float msPerFrame);
+
+    // The staging buffer is submitted once every copy queued from it ran,
+    // so queue all of them before the next Drain()
+    static void QueueBuffer(unsigned int staging,
+                            GLintptr     stagingOffset,
+                            unsigned int buffer,
+                            GLsizeiptr   size,
+                            Priority     priority = HIGH);
+    static void QueueTexture(unsigned int staging,
+                             GLintptr     stagingOffset,
+                             unsigned int texture,
+                             GLenum       format,
+                             int          channels,
+                             int          width,
+                             int          height,
+                             Priority     priority = NORMAL);
+
+    // Once per frame
+    static void Drain();
+
+    static UploadStats GetStats();
+
+  private:
+    struct Upload {
+        bool         texture;
+        unsigned int staging;
+        GLintptr     stagingOffset;
+        unsigned int target;
+        GLsizeiptr   size, done;
+        // Textures only
+        GLenum format;
+        int    rowBytes, width, height;
+    };
+
+    static std::map<int, std::deque<Upload>, std::greater<int>> queues;
+    static std::map<unsigned int, unsigned int>                 stagingUploads;
+    static GLsizeiptr                                           bytesPerFrame;
+    static float                                                msPerFrame;
+    static UploadStats                                          stats;
+
+    static void queue(const Upload &upload, Priority priority);
+    static void finish(const Upload &upload);
+};
+
+#endif // UPLOAD_SCHEDULER_H
@@ -0,0 +1,60 @@
+#ifndef VISIBILITY_BUFFER_H
+#define VISIBILITY_BUFFER_H
+
+#include <vector>
+
+#include <framebuffer.hpp>
+#include <model.hpp>
+#include <shader.hpp>
+
+#include <glm.hpp>
+
+// Visibility buffer renderer. Every mesh added is copied into one shared
+// vertex and index buffer, which the shaders can also read as texture
+// buffers. The geometry pass writes nothing but (draw ID << 24 | triangle ID)
+// per pixel. The resolve pass walks the draws, re-fetches the three vertices
+// of the stored triangle, interpolates its attributes and shades the pixel
+// once, so the cost of dense small triangles stays in the geometry pass.
+class VisibilityBuffer {
+  public:
+    // Draw IDs live in the top 8 bits, 0xFF marks empty pixels
+    static const unsigned int MaxDraws     = 255;
+    static const unsigned int MaxTriangles = 1 << 24;
+
+    VisibilityBuffer(int width, int height);
+    ~VisibilityBuffer();
+
+    unsigned int Add(Model &model);
+    void         SetTransform(unsigned int object, const glm::mat4 &model);
+
+    void Resize(int width, int height);
+    void DrawGeometry(const glm::mat4 &view, const glm::mat4 &projection);
+
+    // Shades into target, which also receives the visibility pass depth.
+    // Lighting uniforms match shaders/model/model.frag and are set by the
+    // caller on GetResolveShader().
+    void    Resolve(Framebuffer &target, const glm::vec3 &viewPos);
+    Shader &GetResolveShader();
+
+  private:
+    struct Draw {
+        Mesh        *mesh;
+        unsigned int object;
+        unsigned int firstIndex, indexCount, baseVertex;
+    };
+
+    Framebuffer               visibility;
+    Shader                    geometryPass, resolvePass;
+    unsigned int              vao, vbo, ebo, fullscreenVAO;
+    unsigned int              vertexTexture, indexTexture;
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+    std::vector<Draw>         draws;
+    std::vector<glm::mat4>    transforms;
+    glm::mat4                 view, projection;
+
+    void upload();
+    bool scissorRect(const Draw &draw, int rect[4]);
+};
+
+#endif // VISIBILITY_BUFFER_H
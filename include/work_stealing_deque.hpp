@@ -0,0 +1,87 @@
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+// Chase-Lev deque of pointers, with the memory orders from Le et al.,
+// "Correct and Efficient Work-Stealing for Weak Memory Models". The owning
+// thread pushes and pops at the bottom, LIFO, which keeps its working set
+// warm; any other thread steals the oldest entry from the top. Capacity is
+// fixed (a power of two) and Push() fails when full, so the owner can run
+// the item itself instead of waiting.
+template <typename T, unsigned int Capacity = 4096> class WorkStealingDeque {
+  public:
+    WorkStealingDeque() : top(0), bottom(0) {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+        for (unsigned int i = 0; i < Capacity; i++) {
+            items[i].store(NULL, std::memory_order_relaxed);
+        }
+    }
+
+    WorkStealingDeque(const WorkStealingDeque &)            = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    // Owner only
+    bool Push(T *item) {
+        long b = bottom.load(std::memory_order_relaxed);
+        long t = top.load(std::memory_order_acquire);
+        if (b - t >= (long)Capacity) {
+            return false;
+        }
+
+        items[b & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only, NULL when empty
+    T *Pop() {
+        long b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return NULL;
+        }
+
+        T *item = items[b & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last item, race the thieves for it
+            if (!top.compare_exchange_strong(
+                    t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = NULL;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread, NULL when empty or when another thread won the race
+    T *Steal() {
+        long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) {
+            return NULL;
+        }
+
+        T *item = items[t & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return NULL;
+        }
+        return item;
+    }
+
+  private:
+    std::atomic<long> top;
+    std::atomic<long> bottom;
+    std::atomic<T *>  items[Capacity];
+};
+
+#endif // WORK_STEALING_DEQUE_H
@@ -0,0 +1,41 @@
+#version 330 core
+
+layout (location = 0) out float Depth;
+
+uniform sampler2D src;
+uniform ivec2 srcSize;
+uniform bool downsample;
+
+float fetch(ivec2 coord) {
+  return texelFetch(src, min(coord, srcSize - 1), 0).r;
+}
+
+void main() {
+  ivec2 dst = ivec2(gl_FragCoord.xy);
+
+  if (!downsample) {
+    Depth = fetch(dst);
+    return;
+  }
+
+  ivec2 base = dst * 2;
+  float d = max(max(fetch(base), fetch(base + ivec2(1, 0))),
+                max(fetch(base + ivec2(0, 1)), fetch(base + ivec2(1, 1))));
+
+  // Odd source sizes leave a row/column that the last texel has to cover too,
+  // otherwise the max would no longer be conservative
+  bool extraX = (srcSize.x & 1) != 0 && dst.x == srcSize.x / 2 - 1;
+  bool extraY = (srcSize.y & 1) != 0 && dst.y == srcSize.y / 2 - 1;
+
+  if (extraX) {
+    d = max(d, max(fetch(base + ivec2(2, 0)), fetch(base + ivec2(2, 1))));
+  }
+  if (extraY) {
+    d = max(d, max(fetch(base + ivec2(0, 2)), fetch(base + ivec2(1, 2))));
+  }
+  if (extraX && extraY) {
+    d = max(d, fetch(base + ivec2(2, 2)));
+  }
+
+  Depth = d;
+}
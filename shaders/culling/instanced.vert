@@ -0,0 +1,26 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 3) in uint aInstance;
+
+struct Instance {
+  mat4 model;
+  vec4 boundsMin;
+  vec4 boundsMax;
+  uint draw;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+  Instance instances[];
+};
+
+out vec2 TexCoords;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+void main() {
+  gl_Position = projection * view * instances[aInstance].model * vec4(aPos, 1.0);
+  TexCoords = aTexCoords;
+}
@@ -0,0 +1,32 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+#include "../include/lights.glsl"
+#include "../include/octahedral.glsl"
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormalShininess;
+uniform sampler2D gDepth;
+
+uniform DirectionalLight dLight;
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPos;
+
+void main() {
+  vec4 albedoSpecular = texture(gAlbedoSpecular, TexCoords);
+  vec4 normalShininess = texture(gNormalShininess, TexCoords);
+
+  vec4 position = inverseViewProjection *
+                  vec4(vec3(TexCoords, texture(gDepth, TexCoords).r) * 2.0 - 1.0, 1.0);
+  vec3 fragPos = position.xyz / position.w;
+
+  vec3 normal = decodeNormal(normalShininess.xy);
+  vec3 viewDir = normalize(viewPos - fragPos);
+  vec3 color = cDirLight(dLight, normal, viewDir, albedoSpecular.rgb, vec3(albedoSpecular.a),
+                         normalShininess.z * 256.0);
+
+  FragColor = vec4(color, 1.0);
+}
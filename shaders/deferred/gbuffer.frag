@@ -0,0 +1,20 @@
+#version 330 core
+
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormalShininess;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+uniform float shininess;
+
+#include "../include/octahedral.glsl"
+
+void main() {
+  gAlbedoSpecular = vec4(texture(texture_diffuse1, TexCoords).rgb,
+                         texture(texture_specular1, TexCoords).r);
+  gNormalShininess = vec4(encodeNormal(normalize(Normal)), shininess / 256.0, 1.0);
+}
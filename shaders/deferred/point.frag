@@ -0,0 +1,48 @@
+#version 330 core
+
+out vec4 FragColor;
+
+flat in vec4 PositionRadius;
+flat in vec4 AmbientConstant;
+flat in vec4 DiffuseLinear;
+flat in vec4 SpecularQuadratic;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormalShininess;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+uniform vec2 viewportSize;
+uniform vec3 viewPos;
+
+#include "../include/lights.glsl"
+#include "../include/octahedral.glsl"
+
+void main() {
+  vec2 uv = gl_FragCoord.xy / viewportSize;
+
+  vec4 position = inverseViewProjection *
+                  vec4(vec3(uv, texture(gDepth, uv).r) * 2.0 - 1.0, 1.0);
+  vec3 fragPos = position.xyz / position.w;
+
+  vec3 toLight = PositionRadius.xyz - fragPos;
+  float distance = length(toLight);
+  if (distance > PositionRadius.w) {
+    discard;
+  }
+
+  vec4 albedoSpecular = texture(gAlbedoSpecular, uv);
+  vec4 normalShininess = texture(gNormalShininess, uv);
+
+  vec3 normal = decodeNormal(normalShininess.xy);
+  vec3 viewDir = normalize(viewPos - fragPos);
+  vec3 lightDir = toLight / distance;
+
+  vec3 color = phong(lightDir, normal, viewDir, AmbientConstant.rgb, DiffuseLinear.rgb,
+                     SpecularQuadratic.rgb, albedoSpecular.rgb, vec3(albedoSpecular.a),
+                     normalShininess.z * 256.0);
+  float attenuation =
+      lightAttenuation(AmbientConstant.w, DiffuseLinear.w, SpecularQuadratic.w, distance);
+
+  FragColor = vec4(color * attenuation, 1.0);
+}
@@ -0,0 +1,23 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec4 aPositionRadius;
+layout (location = 2) in vec4 aAmbientConstant;
+layout (location = 3) in vec4 aDiffuseLinear;
+layout (location = 4) in vec4 aSpecularQuadratic;
+
+flat out vec4 PositionRadius;
+flat out vec4 AmbientConstant;
+flat out vec4 DiffuseLinear;
+flat out vec4 SpecularQuadratic;
+
+uniform mat4 viewProjection;
+
+void main() {
+  gl_Position = viewProjection * vec4(aPositionRadius.xyz + aPosition * aPositionRadius.w, 1.0);
+
+  PositionRadius = aPositionRadius;
+  AmbientConstant = aAmbientConstant;
+  DiffuseLinear = aDiffuseLinear;
+  SpecularQuadratic = aSpecularQuadratic;
+}
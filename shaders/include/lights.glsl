@@ -0,0 +1,53 @@
+// Light types and Phong terms shared by the lit shaders, the structs match
+// include/lights.hpp. Pulled in with #include, see shader_source.hpp.
+
+struct PointLight {
+  vec3 position;
+
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+
+  float constant;
+  float linear;
+  float quadratic;
+};
+
+struct DirectionalLight {
+  vec3 direction;
+
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+};
+
+float lightAttenuation(float constant, float linear, float quadratic, float distance) {
+  return 1.0 / (constant + linear * distance + quadratic * (distance * distance));
+}
+
+// Ambient, diffuse and specular from one light arriving along lightDir
+vec3 phong(vec3 lightDir, vec3 normal, vec3 viewDir, vec3 ambient, vec3 diffuse, vec3 specular,
+           vec3 diffuseTex, vec3 specularTex, float shininess) {
+  float diff = max(dot(normal, lightDir), 0.0);
+
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+  return ambient * diffuseTex + diffuse * diff * diffuseTex + specular * spec * specularTex;
+}
+
+vec3 cDirLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 diffuseTex,
+               vec3 specularTex, float shininess) {
+  return phong(normalize(-light.direction), normal, viewDir, light.ambient, light.diffuse,
+               light.specular, diffuseTex, specularTex, shininess);
+}
+
+vec3 cPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseTex,
+                 vec3 specularTex, float shininess) {
+  vec3 toLight = light.position - fragPos;
+  float distance = length(toLight);
+
+  return phong(toLight / distance, normal, viewDir, light.ambient, light.diffuse,
+               light.specular, diffuseTex, specularTex, shininess) *
+         lightAttenuation(light.constant, light.linear, light.quadratic, distance);
+}
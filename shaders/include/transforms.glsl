@@ -0,0 +1,9 @@
+// Per-object transforms and the camera position, one uniform buffer write
+// per object. C++ side is TransformsBlock in the generated uniform_blocks.hpp.
+
+layout (std140) uniform Transforms {
+  mat4 model;
+  mat4 view;
+  mat4 projection;
+  vec3 viewPos;
+};
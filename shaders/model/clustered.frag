@@ -0,0 +1,66 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+
+#include "../include/lights.glsl"
+#include "../include/transforms.glsl"
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+
+// Filled by ClusteredLights, see include/clustered_lights.hpp
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+uniform vec3 clusterCount;
+uniform vec2 clusterTileSize;
+uniform vec2 clusterDepthScaleBias;
+
+uniform DirectionalLight dLight;
+uniform float shininess;
+
+// Packed as in ClusteredLights, the radius rides in position.w
+PointLight fetchLight(int index, out float radius) {
+  vec4 position = texelFetch(lightData, index * 4);
+  vec4 ambient = texelFetch(lightData, index * 4 + 1);
+  vec4 diffuse = texelFetch(lightData, index * 4 + 2);
+  vec4 specular = texelFetch(lightData, index * 4 + 3);
+
+  radius = position.w;
+  return PointLight(position.xyz, ambient.rgb, diffuse.rgb, specular.rgb,
+                    ambient.w, diffuse.w, specular.w);
+}
+
+void main() {
+  vec3 norm = normalize(Normal);
+  vec3 viewDir = normalize(viewPos - FragPos);
+
+  // Texture fetches are shared by every light touching the fragment
+  vec3 diffuseTex = vec3(texture(texture_diffuse1, TexCoords));
+  vec3 specularTex = vec3(texture(texture_specular1, TexCoords));
+
+  vec3 result = cDirLight(dLight, norm, viewDir, diffuseTex, specularTex, shininess);
+
+  float depth = -(view * vec4(FragPos, 1.0)).z;
+  ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / clusterTileSize),
+                        int(log(depth) * clusterDepthScaleBias.x + clusterDepthScaleBias.y));
+  ivec3 count = ivec3(clusterCount);
+  cluster = clamp(cluster, ivec3(0), count - 1);
+
+  int clusterIndex = (cluster.z * count.y + cluster.y) * count.x + cluster.x;
+  uvec2 range = texelFetch(clusterGrid, clusterIndex).xy;
+
+  for (uint i = 0u; i < range.y; i++) {
+    float radius;
+    PointLight light = fetchLight(int(texelFetch(lightIndices, int(range.x + i)).r), radius);
+    if (length(light.position - FragPos) <= radius) {
+      result += cPointLight(light, norm, FragPos, viewDir, diffuseTex, specularTex, shininess);
+    }
+  }
+
+  FragColor = vec4(result, 1.0);
+}
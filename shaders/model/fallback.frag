@@ -0,0 +1,13 @@
+#version 330 core
+
+// Stand-in while ShaderManager builds the real program: flat gray shaded
+// by the normal, no textures or lights
+
+in vec3 Normal;
+
+out vec4 FragColor;
+
+void main() {
+  float shade = 0.4 + 0.4 * abs(normalize(Normal).y);
+  FragColor = vec4(vec3(shade), 1.0);
+}
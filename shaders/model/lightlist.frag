@@ -0,0 +1,58 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+
+// Keep in sync with LightManager::MaxLightsPerObject
+#define MAX_LIGHTS 8
+
+#include "../include/lights.glsl"
+#include "../include/transforms.glsl"
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+
+// Per-object list from LightManager, four vec4s per light: position +
+// radius, then ambient, diffuse and specular with constant, linear and
+// quadratic attenuation in w
+uniform vec4 lightList[MAX_LIGHTS * 4];
+uniform int lightCount;
+
+uniform DirectionalLight dLight;
+uniform float shininess;
+
+vec3 cListLight(int i, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseTex,
+                vec3 specularTex) {
+  vec4 positionRadius = lightList[i * 4];
+  vec4 ambientConstant = lightList[i * 4 + 1];
+  vec4 diffuseLinear = lightList[i * 4 + 2];
+  vec4 specularQuadratic = lightList[i * 4 + 3];
+
+  if (length(positionRadius.xyz - fragPos) > positionRadius.w) {
+    return vec3(0.0);
+  }
+
+  PointLight light = PointLight(positionRadius.xyz, ambientConstant.rgb, diffuseLinear.rgb,
+                                specularQuadratic.rgb, ambientConstant.w, diffuseLinear.w,
+                                specularQuadratic.w);
+  return cPointLight(light, normal, fragPos, viewDir, diffuseTex, specularTex, shininess);
+}
+
+void main() {
+  vec3 norm = normalize(Normal);
+  vec3 viewDir = normalize(viewPos - FragPos);
+
+  vec3 diffuseTex = vec3(texture(texture_diffuse1, TexCoords));
+  vec3 specularTex = vec3(texture(texture_specular1, TexCoords));
+
+  vec3 result = cDirLight(dLight, norm, viewDir, diffuseTex, specularTex, shininess);
+
+  for (int i = 0; i < lightCount; i++) {
+    result += cListLight(i, norm, FragPos, viewDir, diffuseTex, specularTex);
+  }
+
+  FragColor = vec4(result, 1.0);
+}
@@ -1,85 +1,58 @@
 #version 330 core
 
+// Built by ShaderVariants when loaded through it. Loaded directly it keeps
+// its original form: two point lights and a specular map.
+#ifndef SHADER_VARIANTS
+#define HAS_SPECULAR_MAP
+#define POINT_LIGHT_COUNT 2
+#endif
+
 out vec4 FragColor;
 
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
 
-struct PointLight {
-  vec3 position;
-
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-
-  float constant;
-  float linear;
-  float quadratic;
-};
-
-struct DirectionalLight {
-  vec3 	     direction;
-
-  vec3 	     ambient;
-  vec3 	     diffuse;
-  vec3 	     specular;
-};
+#include "../include/lights.glsl"
+#include "../include/transforms.glsl"
 
 uniform sampler2D texture_diffuse1;
+#ifdef HAS_SPECULAR_MAP
 uniform sampler2D texture_specular1;
+#endif
 
-uniform PointLight pointLights[2];
+#if POINT_LIGHT_COUNT > 0
+uniform PointLight pointLights[POINT_LIGHT_COUNT];
+#endif
 uniform DirectionalLight dLight;
-uniform vec3 viewPos;
 uniform float shininess;
 
-vec3 cDirLight(DirectionalLight light, vec3 normal, vec3 viewDir) {
-  vec3 lightDir = normalize(-light.direction);
-
-  float diff = max(dot(normal, lightDir), 0.0);
-  
-  vec3 reflectDir = reflect(-lightDir, normal);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-
-  vec3 ambient = light.ambient * vec3(texture(texture_diffuse1, TexCoords));
-  vec3 diffuse = light.diffuse * diff * vec3(texture(texture_diffuse1, TexCoords));
-  vec3 specular = light.specular * spec * vec3(texture(texture_specular1, TexCoords));
-
-  return (ambient + diffuse + specular);
-}
-
-vec3 cPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
-  vec3 lightDir = normalize(light.position);
-
-  float diff = max(dot(normal, lightDir), 0.0);
-
-  vec3 reflectDir = reflect(-lightDir, normal);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-
-  float distance = length(light.position - fragPos);
-  float attenuation = 1.0 / (light.constant + light.linear * distance +
-       		        light.quadratic * (distance * distance));
-
-  vec3 ambient = light.ambient * vec3(texture(texture_diffuse1, TexCoords));
-  vec3 diffuse = light.diffuse * diff * vec3(texture(texture_diffuse1, TexCoords));
-  vec3 specular = light.specular * spec * vec3(texture(texture_specular1, TexCoords));
-
-  ambient *= attenuation;
-  diffuse *= attenuation;
-  specular *= attenuation;
-
-  return (ambient + diffuse + specular);
-}
-
 void main() {
+  vec4 diffuseSample = texture(texture_diffuse1, TexCoords);
+#ifdef ALPHA_TEST
+  if (diffuseSample.a < 0.5) {
+    discard;
+  }
+#endif
+  vec3 diffuseTex = diffuseSample.rgb;
+#ifdef HAS_SPECULAR_MAP
+  vec3 specularTex = vec3(texture(texture_specular1, TexCoords));
+#else
+  // Constant zero, the specular terms fold away
+  const vec3 specularTex = vec3(0.0);
+#endif
+
   vec3 norm = normalize(Normal);
   vec3 viewDir = normalize(viewPos - FragPos);
 
-  vec3 result = cDirLight(dLight, norm, viewDir);
+  vec3 result = cDirLight(dLight, norm, viewDir, diffuseTex, specularTex, shininess);
 
-  result += cPointLight(pointLights[0], norm, FragPos, viewDir);
-  result += cPointLight(pointLights[1], norm, FragPos, viewDir);
+#if POINT_LIGHT_COUNT > 0
+  for (int i = 0; i < POINT_LIGHT_COUNT; i++) {
+    result += cPointLight(pointLights[i], norm, FragPos, viewDir, diffuseTex, specularTex,
+                          shininess);
+  }
+#endif
 
   FragColor = vec4(result, 1.0);
 }
@@ -1,21 +1,38 @@
 #version 330 core
 
+// Built by ShaderVariants when loaded through it, see shader_variants.hpp
+
 layout (location = 0) in vec3 aPosition;
+#ifdef VERTEX_POSITION_UV
+layout (location = 1) in vec2 aTexCoords;
+#else
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#endif
+#ifdef INSTANCED
+layout (location = 3) in mat4 aModel;
+#endif
 
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "../include/transforms.glsl"
+
+invariant gl_Position;
 
 void main() {
+#ifdef INSTANCED
+  mat4 model = aModel;
+#endif
+
   gl_Position = projection * view * model * vec4(aPosition, 1.0);
 
   TexCoords = aTexCoords;
+#ifdef VERTEX_POSITION_UV
+  Normal = vec3(0.0, 1.0, 0.0);
+#else
   Normal = aNormal;
+#endif
   FragPos = vec3(model * vec4(aPosition, 1.0));
 }
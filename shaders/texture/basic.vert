@@ -5,9 +5,9 @@ layout (location = 1) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+#include "../include/transforms.glsl"
+
+invariant gl_Position;
 
 void main() {
   gl_Position = projection * view *  model * vec4(aPos, 1.0);
@@ -0,0 +1,11 @@
+#version 330 core
+
+layout (location = 0) out uint Visibility;
+
+uniform uint drawID;
+
+void main() {
+  // Without a geometry shader gl_PrimitiveID counts triangles from the start
+  // of the draw, which is the triangle's place in the draw's index range
+  Visibility = (drawID << 24) | uint(gl_PrimitiveID);
+}
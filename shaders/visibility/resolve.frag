@@ -0,0 +1,95 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+#include "../include/lights.glsl"
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+
+uniform usampler2D visibility;
+uniform samplerBuffer vertices;
+uniform usamplerBuffer indices;
+uniform uint drawID;
+uniform uint firstIndex;
+uniform uint baseVertex;
+uniform mat4 model;
+uniform mat4 mvp;
+uniform vec2 viewportSize;
+
+uniform PointLight pointLights[2];
+uniform DirectionalLight dLight;
+uniform vec3 viewPos;
+uniform float shininess;
+
+float cross2(vec2 a, vec2 b) {
+  return a.x * b.y - a.y * b.x;
+}
+
+// Perspective-correct barycentrics of an NDC position inside the triangle
+vec3 barycentrics(vec4 c0, vec4 c1, vec4 c2, vec2 ndc) {
+  vec3 invW = 1.0 / vec3(c0.w, c1.w, c2.w);
+  vec2 p0 = c0.xy * invW.x;
+  vec2 p1 = c1.xy * invW.y;
+  vec2 p2 = c2.xy * invW.z;
+
+  float area = cross2(p1 - p0, p2 - p0);
+  float b1 = cross2(ndc - p0, p2 - p0) / area;
+  float b2 = cross2(p1 - p0, ndc - p0) / area;
+
+  vec3 weights = vec3(1.0 - b1 - b2, b1, b2) * invW;
+  return weights / (weights.x + weights.y + weights.z);
+}
+
+void main() {
+  uint packed = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0).r;
+  if ((packed >> 24) != drawID) {
+    discard;
+  }
+
+  int triangle = int(packed & 0xFFFFFFu);
+  vec4 a[3];
+  vec4 b[3];
+  vec4 clip[3];
+  for (int i = 0; i < 3; i++) {
+    int index = int(baseVertex + texelFetch(indices, int(firstIndex) + triangle * 3 + i).r);
+    a[i] = texelFetch(vertices, index * 2);
+    b[i] = texelFetch(vertices, index * 2 + 1);
+    clip[i] = mvp * vec4(a[i].xyz, 1.0);
+  }
+
+  // Barycentrics one pixel over in x and y give the UV gradients that
+  // hardware derivatives would have produced for the original triangle
+  vec2 ndc = gl_FragCoord.xy / viewportSize * 2.0 - 1.0;
+  vec2 texel = 2.0 / viewportSize;
+  vec3 w = barycentrics(clip[0], clip[1], clip[2], ndc);
+  vec3 wx = barycentrics(clip[0], clip[1], clip[2], ndc + vec2(texel.x, 0.0));
+  vec3 wy = barycentrics(clip[0], clip[1], clip[2], ndc + vec2(0.0, texel.y));
+
+  mat3x2 uvs = mat3x2(b[0].zw, b[1].zw, b[2].zw);
+  vec2 uv = uvs * w;
+  vec2 dx = uvs * wx - uv;
+  vec2 dy = uvs * wy - uv;
+
+  vec3 position = mat3(a[0].xyz, a[1].xyz, a[2].xyz) * w;
+  vec3 normal = mat3(vec3(a[0].w, b[0].xy), vec3(a[1].w, b[1].xy), vec3(a[2].w, b[2].xy)) * w;
+
+  // Same spaces as model.vert: world position, untransformed normal
+  vec3 fragPos = vec3(model * vec4(position, 1.0));
+  vec3 norm = normalize(normal);
+  vec3 viewDir = normalize(viewPos - fragPos);
+
+  vec3 diffuseTex = textureGrad(texture_diffuse1, uv, dx, dy).rgb;
+  vec3 specularTex = textureGrad(texture_specular1, uv, dx, dy).rgb;
+
+  vec3 result = cDirLight(dLight, norm, viewDir, diffuseTex, specularTex, shininess);
+
+  for (int i = 0; i < 2; i++) {
+    result +=
+        cPointLight(pointLights[i], norm, fragPos, viewDir, diffuseTex, specularTex, shininess);
+  }
+
+  FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,242 @@
+#include <clustered_lights.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+enum {
+    LIGHT_DATA,
+    CLUSTER_GRID,
+    LIGHT_INDICES
+};
+
+ClusteredLights::ClusteredLights(float near, float far) {
+    this->near       = near;
+    this->far        = far;
+    this->projection = glm::mat4(0.0f);
+    this->stats      = ClusterStats();
+
+    clusters.resize(ClustersX * ClustersY * ClustersZ);
+    grid.resize(clusters.size() * 2);
+
+    GLenum formats[] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+    for (int i = 0; i < 3; i++) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+ClusteredLights::~ClusteredLights() {
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+}
+
+void ClusteredLights::Update(const std::vector<PointLight> &lights,
+                             const glm::mat4               &view,
+                             const glm::mat4               &projection) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (projection != this->projection) {
+        buildClusters(projection);
+    }
+
+    // Four texels per light: position + radius, then ambient, diffuse and
+    // specular with the attenuation terms in w
+    lightData.resize(std::max<size_t>(1, lights.size() * 4));
+    for (unsigned int z = 0; z < ClustersZ; z++) {
+        sliceX[z].clear();
+        sliceY[z].clear();
+        sliceZ[z].clear();
+        sliceRadius2[z].clear();
+        sliceLights[z].clear();
+    }
+
+    for (unsigned int i = 0; i < lights.size(); i++) {
+        const PointLight &light  = lights[i];
+        float             radius = light.Radius();
+        glm::vec3         center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+
+        lightData[i * 4 + 0] = glm::vec4(light.position, radius);
+        lightData[i * 4 + 1] = glm::vec4(light.ambient, light.constant);
+        lightData[i * 4 + 2] = glm::vec4(light.diffuse, light.linear);
+        lightData[i * 4 + 3] = glm::vec4(light.specular, light.quadratic);
+
+        float nearest  = -center.z - radius;
+        float farthest = -center.z + radius;
+        if (farthest < near || nearest > far) {
+            continue;
+        }
+
+        int first = slice(std::max(nearest, near));
+        int last  = slice(std::min(farthest, far));
+        for (int z = first; z <= last; z++) {
+            sliceX[z].push_back(center.x);
+            sliceY[z].push_back(center.y);
+            sliceZ[z].push_back(center.z);
+            sliceRadius2[z].push_back(radius * radius);
+            sliceLights[z].push_back(i);
+        }
+    }
+
+    indices.clear();
+    stats.activeClusters = 0;
+
+    for (unsigned int z = 0; z < ClustersZ; z++) {
+        // Pad with lights that can never hit, distances are never negative
+        while (sliceX[z].size() % 4 != 0) {
+            sliceX[z].push_back(0.0f);
+            sliceY[z].push_back(0.0f);
+            sliceZ[z].push_back(0.0f);
+            sliceRadius2[z].push_back(-1.0f);
+        }
+
+        unsigned int first = z * ClustersX * ClustersY;
+        for (unsigned int c = first; c < first + ClustersX * ClustersY; c++) {
+            const AABB  &box    = clusters[c];
+            unsigned int offset = indices.size();
+
+#ifdef __SSE2__
+            __m128 zero = _mm_setzero_ps();
+            __m128 minX = _mm_set1_ps(box.min.x), maxX = _mm_set1_ps(box.max.x);
+            __m128 minY = _mm_set1_ps(box.min.y), maxY = _mm_set1_ps(box.max.y);
+            __m128 minZ = _mm_set1_ps(box.min.z), maxZ = _mm_set1_ps(box.max.z);
+
+            for (unsigned int j = 0; j < sliceX[z].size(); j += 4) {
+                __m128 x = _mm_loadu_ps(&sliceX[z][j]);
+                __m128 y = _mm_loadu_ps(&sliceY[z][j]);
+                __m128 w = _mm_loadu_ps(&sliceZ[z][j]);
+
+                // Distance from the sphere centre to the box, per axis
+                __m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)));
+                __m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)));
+                __m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(minZ, w), _mm_sub_ps(w, maxZ)));
+                __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                       _mm_mul_ps(dz, dz));
+
+                int hits = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_loadu_ps(&sliceRadius2[z][j])));
+                for (int k = 0; hits != 0; k++, hits >>= 1) {
+                    if ((hits & 1) && indices.size() - offset < MaxLightsPerCluster) {
+                        indices.push_back(sliceLights[z][j + k]);
+                    }
+                }
+            }
+#else
+            for (unsigned int j = 0; j < sliceLights[z].size(); j++) {
+                glm::vec3 center(sliceX[z][j], sliceY[z][j], sliceZ[z][j]);
+                glm::vec3 d =
+                    glm::max(glm::vec3(0.0f), glm::max(box.min - center, center - box.max));
+                if (glm::dot(d, d) <= sliceRadius2[z][j] &&
+                    indices.size() - offset < MaxLightsPerCluster) {
+                    indices.push_back(sliceLights[z][j]);
+                }
+            }
+#endif
+
+            grid[c * 2]     = offset;
+            grid[c * 2 + 1] = indices.size() - offset;
+            if (indices.size() > offset) {
+                stats.activeClusters++;
+            }
+        }
+    }
+
+    if (indices.empty()) {
+        indices.push_back(0);
+    }
+
+    // Orphan and refill, the previous frame may still be reading the old data
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[LIGHT_DATA]);
+    glBufferData(GL_TEXTURE_BUFFER,
+                 lightData.size() * sizeof(glm::vec4),
+                 lightData.data(),
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[CLUSTER_GRID]);
+    glBufferData(GL_TEXTURE_BUFFER,
+                 grid.size() * sizeof(unsigned int),
+                 grid.data(),
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[LIGHT_INDICES]);
+    glBufferData(GL_TEXTURE_BUFFER,
+                 indices.size() * sizeof(unsigned int),
+                 indices.data(),
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    stats.lights   = lights.size();
+    stats.indices  = indices.size();
+    stats.assignMs = elapsed.count();
+}
+
+void ClusteredLights::Bind(Shader &shader, int viewportWidth, int viewportHeight) {
+    unsigned int units[] = {LightDataUnit, ClusterUnit, LightIndexUnit};
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + units[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    float logRatio = std::log(far / near);
+
+    shader.setInt("lightData", LightDataUnit);
+    shader.setInt("clusterGrid", ClusterUnit);
+    shader.setInt("lightIndices", LightIndexUnit);
+    shader.setVec3("clusterCount", glm::vec3(ClustersX, ClustersY, ClustersZ));
+    shader.setVec2("clusterTileSize",
+                   (float)viewportWidth / ClustersX,
+                   (float)viewportHeight / ClustersY);
+    shader.setVec2("clusterDepthScaleBias",
+                   ClustersZ / logRatio,
+                   -(float)ClustersZ * std::log(near) / logRatio);
+}
+
+ClusterStats ClusteredLights::GetStats() {
+    return stats;
+}
+
+void ClusteredLights::buildClusters(const glm::mat4 &projection) {
+    this->projection = projection;
+
+    for (unsigned int z = 0; z < ClustersZ; z++) {
+        float sliceNear = near * std::pow(far / near, (float)z / ClustersZ);
+        float sliceFar  = near * std::pow(far / near, (float)(z + 1) / ClustersZ);
+
+        for (unsigned int y = 0; y < ClustersY; y++) {
+            for (unsigned int x = 0; x < ClustersX; x++) {
+                AABB box;
+
+                // Tile corners in NDC pushed out to both slice planes
+                for (int corner = 0; corner < 4; corner++) {
+                    float ndcX = ((x + (corner & 1)) / (float)ClustersX) * 2.0f - 1.0f;
+                    float ndcY = ((y + ((corner >> 1) & 1)) / (float)ClustersY) * 2.0f - 1.0f;
+
+                    float depths[] = {sliceNear, sliceFar};
+                    for (int d = 0; d < 2; d++) {
+                        box.Expand(glm::vec3(ndcX * depths[d] / projection[0][0],
+                                             ndcY * depths[d] / projection[1][1],
+                                             -depths[d]));
+                    }
+                }
+
+                clusters[(z * ClustersY + y) * ClustersX + x] = box;
+            }
+        }
+    }
+}
+
+int ClusteredLights::slice(float depth) {
+    int z = (int)std::floor(std::log(depth / near) / std::log(far / near) * ClustersZ);
+    return std::max(0, std::min((int)ClustersZ - 1, z));
+}
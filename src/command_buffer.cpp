@@ -0,0 +1,118 @@
+#include <command_buffer.hpp>
+
+#include <string.h>
+
+void CommandBuffer::Clear(const glm::vec4 &color) {
+    ClearCommand command = {{color.x, color.y, color.z, color.w}};
+    write(CLEAR, &command, sizeof(command));
+}
+
+void CommandBuffer::Viewport(int x, int y, int width, int height) {
+    ViewportCommand command = {x, y, width, height};
+    write(VIEWPORT, &command, sizeof(command));
+}
+
+void CommandBuffer::Enable(State state) {
+    HandleCommand command = {(unsigned int)state};
+    write(ENABLE, &command, sizeof(command));
+}
+
+void CommandBuffer::Disable(State state) {
+    HandleCommand command = {(unsigned int)state};
+    write(DISABLE, &command, sizeof(command));
+}
+
+void CommandBuffer::UseProgram(unsigned int program) {
+    HandleCommand command = {program};
+    write(USE_PROGRAM, &command, sizeof(command));
+}
+
+void CommandBuffer::SetInt(const char *name, int value) {
+    IntCommand command = {value, (unsigned int)strlen(name)};
+    // The terminator is copied too, the backend reads the name in place
+    write(SET_INT, &command, sizeof(command), name, command.nameLength + 1);
+}
+
+void CommandBuffer::BindTexture(unsigned int unit, Texture *texture) {
+    TextureCommand command = {unit, texture};
+    write(BIND_TEXTURE, &command, sizeof(command));
+}
+
+void CommandBuffer::BindVertexArray(unsigned int vertexArray) {
+    HandleCommand command = {vertexArray};
+    write(BIND_VERTEX_ARRAY, &command, sizeof(command));
+}
+
+void CommandBuffer::UniformBlock(unsigned int binding, const void *data, unsigned int size) {
+    UniformBlockCommand command = {binding, size};
+    write(UNIFORM_BLOCK, &command, sizeof(command), data, size);
+}
+
+void CommandBuffer::DrawIndexed(unsigned int count, unsigned int firstIndex) {
+    DrawCommand command = {count, firstIndex};
+    write(DRAW_INDEXED, &command, sizeof(command));
+}
+
+void CommandBuffer::Present() {
+    write(PRESENT, NULL, 0);
+}
+
+void CommandBuffer::Call(std::function<void()> callback) {
+    HandleCommand command = {(unsigned int)callbacks.size()};
+    callbacks.push_back(std::move(callback));
+    write(CALL, &command, sizeof(command));
+}
+
+void CommandBuffer::Reset() {
+    bytes.clear();
+    callbacks.clear();
+    commands = 0;
+}
+
+bool CommandBuffer::Next(size_t &offset, Header &header, const unsigned char *&payload) const {
+    if (offset + sizeof(Header) > bytes.size()) {
+        return false;
+    }
+
+    memcpy(&header, &bytes[offset], sizeof(Header));
+    payload = bytes.data() + offset + sizeof(Header);
+    offset += header.size;
+    return true;
+}
+
+void CommandBuffer::RunCall(const unsigned char *payload) const {
+    HandleCommand command;
+    memcpy(&command, payload, sizeof(command));
+    callbacks[command.handle]();
+}
+
+unsigned int CommandBuffer::GetCommandCount() const {
+    return commands;
+}
+
+size_t CommandBuffer::GetSize() const {
+    return bytes.size();
+}
+
+void CommandBuffer::write(Type        type,
+                          const void *payload,
+                          size_t      payloadSize,
+                          const void *extra,
+                          size_t      extraSize) {
+    Header header;
+    header.type = type;
+    header.size = (sizeof(Header) + payloadSize + extraSize + 7) & ~7;
+
+    size_t offset = bytes.size();
+    bytes.resize(offset + header.size);
+
+    unsigned char *out = &bytes[offset];
+    memcpy(out, &header, sizeof(header));
+    if (payloadSize) {
+        memcpy(out + sizeof(header), payload, payloadSize);
+    }
+    if (extraSize) {
+        memcpy(out + sizeof(header) + payloadSize, extra, extraSize);
+    }
+    commands++;
+}
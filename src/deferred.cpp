@@ -0,0 +1,271 @@
+#include <deferred.hpp>
+
+#include <cmath>
+
+#include <gtc/constants.hpp>
+
+static const int SphereSlices = 16;
+static const int SphereStacks = 8;
+
+DeferredRenderer::DeferredRenderer(int width, int height)
+    : gbuffer(width, height, {GL_RGBA8, GL_RGB10_A2}),
+      geometryPass("shaders/model/model.vert", "shaders/deferred/gbuffer.frag"),
+      directionalPass("shaders/culling/fullscreen.vert", "shaders/deferred/directional.frag"),
+      pointPass("shaders/deferred/volume.vert", "shaders/deferred/point.frag") {
+    view       = glm::mat4(1.0f);
+    projection = glm::mat4(1.0f);
+
+    glGenVertexArrays(1, &fullscreenVAO);
+    createSphere();
+}
+
+DeferredRenderer::~DeferredRenderer() {
+    glDeleteVertexArrays(1, &sphereVAO);
+    glDeleteVertexArrays(1, &fullscreenVAO);
+    glDeleteBuffers(1, &sphereVBO);
+    glDeleteBuffers(1, &sphereEBO);
+    glDeleteBuffers(1, &instanceVBO);
+    glDeleteProgram(geometryPass.ID);
+    glDeleteProgram(directionalPass.ID);
+    glDeleteProgram(pointPass.ID);
+}
+
+void DeferredRenderer::Resize(int width, int height) {
+    gbuffer.Resize(width, height);
+}
+
+Shader &DeferredRenderer::BeginGeometry(const glm::mat4 &view,
+                                        const glm::mat4 &projection,
+                                        float            shininess) {
+    this->view       = view;
+    this->projection = projection;
+
+    gbuffer.Bind();
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    // Stencil marks covered pixels so lighting skips the background
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    glStencilMask(0xFF);
+
+    geometryPass.use();
+    geometryPass.setFloat("shininess", shininess);
+    return geometryPass;
+}
+
+void DeferredRenderer::EndGeometry() {
+    glDisable(GL_STENCIL_TEST);
+}
+
+void DeferredRenderer::Light(Framebuffer                   &target,
+                             const DirectionalLight        &directional,
+                             const std::vector<PointLight> &pointLights,
+                             const glm::vec3               &viewPos) {
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend     = glIsEnabled(GL_BLEND);
+    GLboolean cullFace  = glIsEnabled(GL_CULL_FACE);
+    GLint     cullMode, depthFunc, blendSrc, blendDst;
+
+    glGetIntegerv(GL_CULL_FACE_MODE, &cullMode);
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrc);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blendDst);
+
+    int width  = gbuffer.GetWidth();
+    int height = gbuffer.GetHeight();
+
+    // The target shares the G-buffer's depth and coverage stencil from here on
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer.GetID());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.GetID());
+    glBlitFramebuffer(0,
+                      0,
+                      width,
+                      height,
+                      0,
+                      0,
+                      target.GetWidth(),
+                      target.GetHeight(),
+                      GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT,
+                      GL_NEAREST);
+    target.Bind();
+
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_EQUAL, 1, 0xFF);
+    glStencilMask(0x00);
+    glDepthMask(GL_FALSE);
+
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+
+    // Directional light and ambient overwrite the covered pixels
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+
+    directionalPass.use();
+    bindGBuffer(directionalPass);
+    directionalPass.setMat4("inverseViewProjection", inverseViewProjection);
+    directionalPass.setVec3("viewPos", viewPos);
+    directionalPass.setVec3("dLight.direction", directional.direction);
+    directionalPass.setVec3("dLight.ambient", directional.ambient);
+    directionalPass.setVec3("dLight.diffuse", directional.diffuse);
+    directionalPass.setVec3("dLight.specular", directional.specular);
+    glBindVertexArray(fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (!pointLights.empty()) {
+        // Same packing as the clustered path: position + radius, then
+        // ambient, diffuse and specular with the attenuation terms in w
+        instances.resize(pointLights.size() * 4);
+        for (unsigned int i = 0; i < pointLights.size(); i++) {
+            const PointLight &light = pointLights[i];
+
+            instances[i * 4 + 0] = glm::vec4(light.position, light.Radius());
+            instances[i * 4 + 1] = glm::vec4(light.ambient, light.constant);
+            instances[i * 4 + 2] = glm::vec4(light.diffuse, light.linear);
+            instances[i * 4 + 3] = glm::vec4(light.specular, light.quadratic);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER,
+                     instances.size() * sizeof(glm::vec4),
+                     instances.data(),
+                     GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Back faces that lie behind the stored surface bound the lit pixels.
+        // This holds with the camera inside a volume, and depth clamping keeps
+        // volumes reaching past the far plane from being clipped open.
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_GEQUAL);
+        glEnable(GL_DEPTH_CLAMP);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        pointPass.use();
+        bindGBuffer(pointPass);
+        pointPass.setMat4("viewProjection", projection * view);
+        pointPass.setMat4("inverseViewProjection", inverseViewProjection);
+        pointPass.setVec3("viewPos", viewPos);
+        glBindVertexArray(sphereVAO);
+        glDrawElementsInstanced(GL_TRIANGLES,
+                                sphereIndexCount,
+                                GL_UNSIGNED_INT,
+                                0,
+                                pointLights.size());
+
+        glDisable(GL_DEPTH_CLAMP);
+    }
+
+    glBindVertexArray(0);
+    for (int i = 2; i >= 0; i--) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glStencilMask(0xFF);
+    glDisable(GL_STENCIL_TEST);
+    glDepthMask(GL_TRUE);
+    glCullFace(cullMode);
+    glDepthFunc(depthFunc);
+    glBlendFunc(blendSrc, blendDst);
+
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+    if (cullFace) {
+        glEnable(GL_CULL_FACE);
+    } else {
+        glDisable(GL_CULL_FACE);
+    }
+}
+
+void DeferredRenderer::bindGBuffer(Shader &shader) {
+    unsigned int textures[] = {gbuffer.GetColor(0), gbuffer.GetColor(1), gbuffer.GetDepth()};
+    const char  *names[]    = {"gAlbedoSpecular", "gNormalShininess", "gDepth"};
+
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        shader.setInt(names[i], i);
+    }
+    shader.setVec2("viewportSize", (float)gbuffer.GetWidth(), (float)gbuffer.GetHeight());
+}
+
+void DeferredRenderer::createSphere() {
+    std::vector<glm::vec3>    vertices;
+    std::vector<unsigned int> indices;
+
+    // Push the vertices out so the flat faces still enclose the unit sphere
+    float scale = 1.0f / std::cos(glm::pi<float>() / SphereStacks);
+
+    for (int stack = 0; stack <= SphereStacks; stack++) {
+        float phi = glm::pi<float>() * stack / SphereStacks;
+        for (int slice = 0; slice <= SphereSlices; slice++) {
+            float theta = 2.0f * glm::pi<float>() * slice / SphereSlices;
+            vertices.push_back(glm::vec3(std::sin(phi) * std::cos(theta),
+                                         std::cos(phi),
+                                         std::sin(phi) * std::sin(theta)) *
+                               scale);
+        }
+    }
+
+    // Counter-clockwise seen from outside
+    for (int stack = 0; stack < SphereStacks; stack++) {
+        for (int slice = 0; slice < SphereSlices; slice++) {
+            unsigned int a = stack * (SphereSlices + 1) + slice;
+            unsigned int b = a + SphereSlices + 1;
+
+            indices.insert(indices.end(), {a, a + 1, b, b, a + 1, b + 1});
+        }
+    }
+    sphereIndexCount = indices.size();
+
+    glGenVertexArrays(1, &sphereVAO);
+    glGenBuffers(1, &sphereVBO);
+    glGenBuffers(1, &sphereEBO);
+    glGenBuffers(1, &instanceVBO);
+
+    glBindVertexArray(sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER,
+                 vertices.size() * sizeof(glm::vec3),
+                 vertices.data(),
+                 GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 indices.size() * sizeof(unsigned int),
+                 indices.data(),
+                 GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+
+    // Four vec4s per light, advanced once per instance
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(1 + i);
+        glVertexAttribPointer(1 + i,
+                              4,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              sizeof(glm::vec4) * 4,
+                              (void *)(sizeof(glm::vec4) * i));
+        glVertexAttribDivisor(1 + i, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
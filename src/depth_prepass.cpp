@@ -0,0 +1,187 @@
+#include <depth_prepass.hpp>
+
+#include <algorithm>
+
+#include <gtc/constants.hpp>
+
+// Fraction of the screen an object must cover before a pre-pass can pay off
+static const float MinCoverage = 0.01f;
+// Cost of one extra triangle relative to shading the full screen once at
+// shadingCost 1.0
+static const float TriangleCost = 2e-6f;
+
+DepthPrepass::DepthPrepass(Mode mode)
+    : depth("shaders/depth/depth.vert", "shaders/culling/empty.frag") {
+    this->mode  = mode;
+    this->frame = 0;
+    this->stats = DepthPrepassStats();
+
+    for (unsigned int i = 0; i < FrameLatency; i++) {
+        glGenQueries(1, &frames[i].depthQuery);
+        frames[i].used    = 0;
+        frames[i].pending = false;
+    }
+}
+
+DepthPrepass::~DepthPrepass() {
+    for (unsigned int i = 0; i < FrameLatency; i++) {
+        glDeleteQueries(1, &frames[i].depthQuery);
+        glDeleteQueries(frames[i].shadingQueries.size(), frames[i].shadingQueries.data());
+    }
+    glDeleteProgram(depth.ID);
+}
+
+unsigned int DepthPrepass::Add(const AABB &bounds, float shadingCost, unsigned int triangles) {
+    Object object;
+    object.bounds      = bounds;
+    object.shadingCost = shadingCost;
+    object.triangles   = triangles;
+    object.prepassed   = false;
+
+    objects.push_back(object);
+    return objects.size() - 1;
+}
+
+void DepthPrepass::BeginDepthPass(const glm::mat4 &view, const glm::mat4 &projection) {
+    this->view       = view;
+    this->projection = projection;
+
+    frame++;
+    Frame &f = frames[frame % FrameLatency];
+    collect(f);
+
+    f.used      = 0;
+    f.objects   = 0;
+    f.prepassed = 0;
+    f.pending   = true;
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        objects[i].prepassed = false;
+    }
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+
+    depth.use();
+    depth.setMat4("view", view);
+    depth.setMat4("projection", projection);
+
+    glBeginQuery(GL_SAMPLES_PASSED, f.depthQuery);
+}
+
+bool DepthPrepass::DrawDepth(unsigned int object, const glm::mat4 &model) {
+    Frame  &f = frames[frame % FrameLatency];
+    Object &o = objects[object];
+
+    f.objects++;
+    if (mode == OFF || !worthIt(o, model)) {
+        return false;
+    }
+
+    o.prepassed = true;
+    f.prepassed++;
+
+    depth.setMat4("model", model);
+    return true;
+}
+
+void DepthPrepass::EndDepthPass() {
+    glEndQuery(GL_SAMPLES_PASSED);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void DepthPrepass::BeginShading(unsigned int object) {
+    if (!objects[object].prepassed) {
+        return;
+    }
+
+    glDepthMask(GL_FALSE);
+    glDepthFunc(mode == LEQUAL ? GL_LEQUAL : GL_EQUAL);
+    glBeginQuery(GL_SAMPLES_PASSED, shadingQuery(frames[frame % FrameLatency]));
+}
+
+void DepthPrepass::EndShading(unsigned int object) {
+    if (!objects[object].prepassed) {
+        return;
+    }
+
+    glEndQuery(GL_SAMPLES_PASSED);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+}
+
+void DepthPrepass::SetMode(Mode mode) {
+    this->mode = mode;
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        objects[i].prepassed = false;
+    }
+}
+
+DepthPrepass::Mode DepthPrepass::GetMode() {
+    return mode;
+}
+
+DepthPrepassStats DepthPrepass::GetStats() {
+    return stats;
+}
+
+bool DepthPrepass::worthIt(const Object &object, const glm::mat4 &model) {
+    AABB      world  = object.bounds.Transform(model);
+    glm::vec3 center = glm::vec3(view * glm::vec4(world.Center(), 1.0f));
+    float     radius = glm::length(world.Extents());
+    float     dist   = -center.z;
+
+    // Projected area of the bounding sphere as a fraction of the screen
+    float coverage = 1.0f;
+    if (dist > radius) {
+        coverage = glm::pi<float>() * radius * radius * projection[0][0] * projection[1][1] /
+                   (4.0f * dist * dist);
+        coverage = std::min(coverage, 1.0f);
+    }
+
+    if (coverage < MinCoverage) {
+        return false;
+    }
+
+    return coverage * object.shadingCost > object.triangles * TriangleCost;
+}
+
+void DepthPrepass::collect(Frame &f) {
+    if (!f.pending) {
+        return;
+    }
+    f.pending = false;
+
+    // Results this old are almost always in. When they are not, drop the
+    // frame rather than wait.
+    GLuint available;
+    glGetQueryObjectuiv(f.depthQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    for (unsigned int i = 0; i < f.used && available; i++) {
+        glGetQueryObjectuiv(f.shadingQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+    if (!available) {
+        return;
+    }
+
+    GLuint64 samples;
+    glGetQueryObjectui64v(f.depthQuery, GL_QUERY_RESULT, &samples);
+    stats.depthSamples  = samples;
+    stats.shadedSamples = 0;
+    for (unsigned int i = 0; i < f.used; i++) {
+        glGetQueryObjectui64v(f.shadingQueries[i], GL_QUERY_RESULT, &samples);
+        stats.shadedSamples += samples;
+    }
+    stats.objects   = f.objects;
+    stats.prepassed = f.prepassed;
+}
+
+unsigned int DepthPrepass::shadingQuery(Frame &f) {
+    if (f.used == f.shadingQueries.size()) {
+        unsigned int query;
+        glGenQueries(1, &query);
+        f.shadingQueries.push_back(query);
+    }
+    return f.shadingQueries[f.used++];
+}
@@ -0,0 +1,217 @@
+#include <draw_list.hpp>
+
+#include <job_system.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+unsigned int DrawList::Add(const AABB  &bounds,
+                           unsigned int vertexArray,
+                           Texture     *texture,
+                           unsigned int indexCount,
+                           Layer        layer,
+                           unsigned int prepass) {
+    Object object;
+    object.bounds      = bounds;
+    object.model       = glm::mat4(1.0f);
+    object.vertexArray = vertexArray;
+    object.texture     = texture;
+    object.indexCount  = indexCount;
+    object.prepass     = prepass;
+    object.layer       = layer;
+    object.enabled     = true;
+
+    std::vector<Texture *>::iterator it = std::find(textures.begin(), textures.end(), texture);
+    object.material                     = it - textures.begin();
+    if (it == textures.end()) {
+        textures.push_back(texture);
+    }
+
+    objects.push_back(object);
+    return objects.size() - 1;
+}
+
+void DrawList::SetTransform(unsigned int object, const glm::mat4 &model) {
+    objects[object].model = model;
+}
+
+void DrawList::SetEnabled(unsigned int object, bool enabled) {
+    objects[object].enabled = enabled;
+}
+
+void DrawList::Build(const glm::mat4 &viewProjection,
+                     const glm::vec3 &viewPos,
+                     OcclusionCuller *occlusion) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    stats         = DrawListStats();
+    stats.objects = objects.size();
+
+    // Slot 0 takes jobs run off the workers, worker i appends to slot i + 1
+    buckets.resize(JobSystem::GetWorkerCount() + 1);
+    for (unsigned int i = 0; i < buckets.size(); i++) {
+        buckets[i].items.clear();
+        buckets[i].frustumCulled   = 0;
+        buckets[i].occlusionCulled = 0;
+    }
+
+    Frustum frustum(viewProjection);
+    JobSystem::ParallelFor(0, objects.size(), ObjectGrain, [&](int first, int last) {
+        cull(first, last, frustum, viewPos, occlusion);
+    });
+
+    merged.clear();
+    entries.clear();
+    for (unsigned int i = 0; i < buckets.size(); i++) {
+        for (unsigned int j = 0; j < buckets[i].items.size(); j++) {
+            SortEntry entry = {buckets[i].items[j].key, (unsigned int)merged.size()};
+            entries.push_back(entry);
+            merged.push_back(buckets[i].items[j]);
+        }
+        stats.frustumCulled += buckets[i].frustumCulled;
+        stats.occlusionCulled += buckets[i].occlusionCulled;
+    }
+    stats.visible = merged.size();
+
+    std::chrono::steady_clock::time_point sortStart = std::chrono::steady_clock::now();
+
+    sort();
+
+    items.resize(entries.size());
+    JobSystem::ParallelFor(0, entries.size(), SortGrain, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            items[i] = merged[entries[i].item];
+        }
+    });
+
+    opaqueCount = 0;
+    while (opaqueCount < items.size() && !(items[opaqueCount].key >> 63)) {
+        opaqueCount++;
+    }
+
+    std::chrono::steady_clock::time_point    end   = std::chrono::steady_clock::now();
+    std::chrono::duration<float, std::milli> build = sortStart - start;
+    std::chrono::duration<float, std::milli> sort  = end - sortStart;
+    stats.buildMs                                  = build.count();
+    stats.sortMs                                   = sort.count();
+}
+
+const std::vector<DrawItem> &DrawList::GetItems() const {
+    return items;
+}
+
+unsigned int DrawList::GetOpaqueCount() const {
+    return opaqueCount;
+}
+
+DrawListStats DrawList::GetStats() const {
+    return stats;
+}
+
+unsigned long long DrawList::sortKey(const Object &object, float distance) {
+    // Non-negative floats order the same as their bit patterns
+    unsigned int depth;
+    memcpy(&depth, &distance, sizeof(depth));
+
+    if (object.layer == TRANSPARENT) {
+        return (1ull << 63) | (unsigned int)~depth;
+    }
+    return (unsigned long long)(object.vertexArray & 0x7fff) << 48 |
+           (unsigned long long)(object.material & 0xffff) << 32 | depth;
+}
+
+void DrawList::cull(int              first,
+                    int              last,
+                    const Frustum   &frustum,
+                    const glm::vec3 &viewPos,
+                    OcclusionCuller *occlusion) {
+    Bucket &bucket = buckets[JobSystem::GetWorkerIndex() + 1];
+
+    for (int i = first; i < last; i++) {
+        const Object &object = objects[i];
+        if (!object.enabled) {
+            continue;
+        }
+
+        AABB world = object.bounds.Transform(object.model);
+        if (!frustum.Intersects(world)) {
+            bucket.frustumCulled++;
+            continue;
+        }
+        if (occlusion && !occlusion->IsVisible(object.bounds, object.model)) {
+            bucket.occlusionCulled++;
+            continue;
+        }
+
+        DrawItem item;
+        item.key         = sortKey(object, glm::length(world.Center() - viewPos));
+        item.vertexArray = object.vertexArray;
+        item.texture     = object.texture;
+        item.indexCount  = object.indexCount;
+        item.prepass     = object.prepass;
+        item.model       = object.model;
+        bucket.items.push_back(item);
+    }
+}
+
+void DrawList::sort() {
+    // Least significant digit first, eight bits a pass. Every pass counts
+    // digits per chunk in parallel, turns the counts into each chunk's output
+    // offsets and scatters the chunks in parallel; chunks keep their order,
+    // so every pass is stable.
+    int count  = entries.size();
+    int chunks = std::max(1, std::min((int)JobSystem::GetWorkerCount(), count / SortGrain));
+    int size   = (count + chunks - 1) / chunks;
+
+    scratch.resize(count);
+    histograms.resize(chunks * 256);
+
+    for (int shift = 0; shift < 64 && count > 1; shift += 8) {
+        JobSystem::ParallelFor(0, chunks, 1, [&](int first, int last) {
+            for (int chunk = first; chunk < last; chunk++) {
+                unsigned int *histogram = &histograms[chunk * 256];
+                std::fill(histogram, histogram + 256, 0);
+
+                int end = std::min(count, (chunk + 1) * size);
+                for (int i = chunk * size; i < end; i++) {
+                    histogram[(entries[i].key >> shift) & 0xff]++;
+                }
+            }
+        });
+
+        // A digit every key shares leaves the order as it is
+        bool uniform = false;
+        for (int digit = 0; digit < 256 && !uniform; digit++) {
+            unsigned int total = 0;
+            for (int chunk = 0; chunk < chunks; chunk++) {
+                total += histograms[chunk * 256 + digit];
+            }
+            uniform = total == (unsigned int)count;
+        }
+        if (uniform) {
+            continue;
+        }
+
+        unsigned int offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            for (int chunk = 0; chunk < chunks; chunk++) {
+                unsigned int counted            = histograms[chunk * 256 + digit];
+                histograms[chunk * 256 + digit] = offset;
+                offset += counted;
+            }
+        }
+
+        JobSystem::ParallelFor(0, chunks, 1, [&](int first, int last) {
+            for (int chunk = first; chunk < last; chunk++) {
+                unsigned int *histogram = &histograms[chunk * 256];
+
+                int end = std::min(count, (chunk + 1) * size);
+                for (int i = chunk * size; i < end; i++) {
+                    scratch[histogram[(entries[i].key >> shift) & 0xff]++] = entries[i];
+                }
+            }
+        });
+        entries.swap(scratch);
+    }
+}
@@ -0,0 +1,93 @@
+#include <frame_sync.hpp>
+
+#include <chrono>
+
+FrameSync::FrameSync(unsigned int framesInFlight) {
+    if (framesInFlight < 1) {
+        framesInFlight = 1;
+    } else if (framesInFlight > MaxFramesInFlight) {
+        framesInFlight = MaxFramesInFlight;
+    }
+
+    this->framesInFlight = framesInFlight;
+    this->slot           = framesInFlight - 1;
+
+    for (unsigned int i = 0; i < MaxFramesInFlight; i++) {
+        fences[i] = (GLsync)0;
+    }
+
+    ResetStats();
+}
+
+FrameSync::~FrameSync() {
+    for (unsigned int i = 0; i < framesInFlight; i++) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+        }
+    }
+}
+
+void FrameSync::BeginFrame() {
+    slot = (slot + 1) % framesInFlight;
+    stats.frames++;
+    stats.lastWaitMs = 0.0f;
+
+    GLsync fence = fences[slot];
+    if (!fence) {
+        stats.averageWaitMs = totalWaitMs / stats.frames;
+        return;
+    }
+    fences[slot] = (GLsync)0;
+
+    // Common case, the GPU is already past this slot's last frame
+    if (glClientWaitSync(fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+        glDeleteSync(fence);
+        stats.averageWaitMs = totalWaitMs / stats.frames;
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Flush on the first try only, the fence may still be queued
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (glClientWaitSync(fence, flags, 1000000) == GL_TIMEOUT_EXPIRED) {
+        flags = 0;
+    }
+    glDeleteSync(fence);
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    stats.stalledFrames++;
+    stats.lastWaitMs = elapsed.count();
+    if (stats.lastWaitMs > stats.maxWaitMs) {
+        stats.maxWaitMs = stats.lastWaitMs;
+    }
+    totalWaitMs += stats.lastWaitMs;
+    stats.averageWaitMs = totalWaitMs / stats.frames;
+}
+
+void FrameSync::EndFrame() {
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+unsigned int FrameSync::GetFramesInFlight() {
+    return framesInFlight;
+}
+
+unsigned int FrameSync::GetSlot() {
+    return slot;
+}
+
+FrameSyncStats FrameSync::GetStats() {
+    return stats;
+}
+
+void FrameSync::ResetStats() {
+    stats.framesInFlight = framesInFlight;
+    stats.frames         = 0;
+    stats.stalledFrames  = 0;
+    stats.lastWaitMs     = 0.0f;
+    stats.averageWaitMs  = 0.0f;
+    stats.maxWaitMs      = 0.0f;
+    totalWaitMs          = 0.0;
+}
@@ -0,0 +1,170 @@
+#include <framebuffer.hpp>
+
+#include <stdio.h>
+
+Framebuffer::Framebuffer(int width, int height, std::vector<GLenum> colorFormats, bool depth) {
+    this->width        = width;
+    this->height       = height;
+    this->colorFormats = colorFormats;
+    this->hasDepth     = depth;
+    this->depth        = 0;
+
+    create();
+}
+
+Framebuffer::~Framebuffer() {
+    destroy();
+}
+
+void Framebuffer::Bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, id);
+    glViewport(0, 0, width, height);
+}
+
+void Framebuffer::Resize(int width, int height) {
+    if (width == this->width && height == this->height) {
+        return;
+    }
+
+    this->width  = width;
+    this->height = height;
+
+    destroy();
+    create();
+}
+
+void Framebuffer::BlitToDefault(int width, int height) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, id);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBlitFramebuffer(0,
+                      0,
+                      this->width,
+                      this->height,
+                      0,
+                      0,
+                      width,
+                      height,
+                      GL_COLOR_BUFFER_BIT,
+                      GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+unsigned int Framebuffer::GetID() {
+    return id;
+}
+
+unsigned int Framebuffer::GetColor(unsigned int index) {
+    return colors[index];
+}
+
+unsigned int Framebuffer::GetDepth() {
+    return depth;
+}
+
+int Framebuffer::GetWidth() {
+    return width;
+}
+
+int Framebuffer::GetHeight() {
+    return height;
+}
+
+static GLenum baseFormat(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_R32F:
+        case GL_R16F:
+        case GL_R8: {
+            return GL_RED;
+        }
+        case GL_R32UI: {
+            return GL_RED_INTEGER;
+        }
+        case GL_RG32UI: {
+            return GL_RG_INTEGER;
+        }
+        case GL_RG16F:
+        case GL_RG8: {
+            return GL_RG;
+        }
+        default: {
+            return GL_RGBA;
+        }
+    }
+}
+
+void Framebuffer::create() {
+    glGenFramebuffers(1, &id);
+    glBindFramebuffer(GL_FRAMEBUFFER, id);
+
+    std::vector<GLenum> drawBuffers;
+    for (unsigned int i = 0; i < colorFormats.size(); i++) {
+        unsigned int texture;
+        GLenum       format = baseFormat(colorFormats[i]);
+        GLenum       type   = (format == GL_RED_INTEGER || format == GL_RG_INTEGER)
+                                  ? GL_UNSIGNED_INT
+                                  : GL_FLOAT;
+        GLint        filter = (type == GL_UNSIGNED_INT) ? GL_NEAREST : GL_LINEAR;
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, colorFormats[i], width, height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_COLOR_ATTACHMENT0 + i,
+                               GL_TEXTURE_2D,
+                               texture,
+                               0);
+
+        colors.push_back(texture);
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+    }
+    glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+
+    if (hasDepth) {
+        glGenTextures(1, &depth);
+        glBindTexture(GL_TEXTURE_2D, depth);
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     GL_DEPTH24_STENCIL8,
+                     width,
+                     height,
+                     0,
+                     GL_DEPTH_STENCIL,
+                     GL_UNSIGNED_INT_24_8,
+                     NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_DEPTH_STENCIL_ATTACHMENT,
+                               GL_TEXTURE_2D,
+                               depth,
+                               0);
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Framebuffer incomplete: %dx%d with %d color attachments\n",
+               width,
+               height,
+               (int)colors.size());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::destroy() {
+    glDeleteFramebuffers(1, &id);
+    glDeleteTextures(colors.size(), colors.data());
+    colors.clear();
+
+    if (depth != 0) {
+        glDeleteTextures(1, &depth);
+        depth = 0;
+    }
+}
@@ -0,0 +1,225 @@
+#include <gpu_culler.hpp>
+
+#include <algorithm>
+
+#include <gtc/type_ptr.hpp>
+
+static const unsigned int WorkgroupSize = 64;
+
+GpuCuller::GpuCuller()
+    : cull("shaders/culling/cull.comp") {
+    glGenBuffers(1, &instanceBuffer);
+    glGenBuffers(1, &visibilityBuffer);
+    glGenBuffers(1, &visibleBuffer);
+    glGenBuffers(2, drawTemplateBuffers);
+    glGenBuffers(2, drawBuffers);
+
+    activeDraws = 0;
+}
+
+GpuCuller::~GpuCuller() {
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteBuffers(1, &visibilityBuffer);
+    glDeleteBuffers(1, &visibleBuffer);
+    glDeleteBuffers(2, drawTemplateBuffers);
+    glDeleteBuffers(2, drawBuffers);
+    glDeleteProgram(cull.ID);
+}
+
+bool GpuCuller::IsSupported() {
+    return GLAD_GL_VERSION_4_3;
+}
+
+unsigned int GpuCuller::AddDraw(unsigned int indexCount, unsigned int firstIndex, int baseVertex) {
+    DrawCommand draw;
+    draw.count         = indexCount;
+    draw.instanceCount = 0;
+    draw.firstIndex    = firstIndex;
+    draw.baseVertex    = baseVertex;
+    draw.baseInstance  = 0;
+
+    draws.push_back(draw);
+    return draws.size() - 1;
+}
+
+void GpuCuller::AddInstance(unsigned int draw, const glm::mat4 &model, const AABB &bounds) {
+    AABB world = bounds.Transform(model);
+
+    Instance instance;
+    instance.model     = model;
+    instance.boundsMin = glm::vec4(world.min, 1.0f);
+    instance.boundsMax = glm::vec4(world.max, 1.0f);
+    instance.draw      = draw;
+
+    instances.push_back(instance);
+}
+
+void GpuCuller::Upload() {
+    // Each draw owns a contiguous range of the visible buffer sized for the
+    // worst case of all its instances surviving
+    for (unsigned int i = 0; i < draws.size(); i++) {
+        draws[i].baseInstance = 0;
+    }
+    for (unsigned int i = 0; i < instances.size(); i++) {
+        draws[instances[i].draw].baseInstance++;
+    }
+
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < draws.size(); i++) {
+        unsigned int count    = draws[i].baseInstance;
+        draws[i].baseInstance = offset;
+        offset += count;
+    }
+
+    // The late phase appends into the second half of the visible buffer so
+    // both phases' results stay valid until they have been drawn
+    std::vector<DrawCommand> lateDraws = draws;
+    for (unsigned int i = 0; i < lateDraws.size(); i++) {
+        lateDraws[i].baseInstance += instances.size();
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 instances.size() * sizeof(Instance),
+                 instances.data(),
+                 GL_STATIC_DRAW);
+
+    // Everything counts as visible on the first frame
+    std::vector<GLuint> visibility(std::max<size_t>(1, instances.size()), 1);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibilityBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 visibility.size() * sizeof(GLuint),
+                 visibility.data(),
+                 GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 std::max<size_t>(1, instances.size()) * 2 * sizeof(GLuint),
+                 NULL,
+                 GL_DYNAMIC_COPY);
+
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_COPY_READ_BUFFER, drawTemplateBuffers[i]);
+        glBufferData(GL_COPY_READ_BUFFER,
+                     draws.size() * sizeof(DrawCommand),
+                     i == 0 ? draws.data() : lateDraws.data(),
+                     GL_STATIC_DRAW);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffers[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     draws.size() * sizeof(DrawCommand),
+                     NULL,
+                     GL_DYNAMIC_COPY);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void GpuCuller::BindInstanceAttribute(unsigned int vao, unsigned int location) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+    glEnableVertexAttribArray(location);
+    glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)0);
+    glVertexAttribDivisor(location, 1);
+    glBindVertexArray(0);
+}
+
+void GpuCuller::Cull(const glm::mat4 &viewProjection,
+                     HiZPyramid      *hiZ,
+                     const glm::mat4 &hiZViewProjection) {
+    dispatch(SINGLE, viewProjection, hiZ, hiZViewProjection);
+}
+
+void GpuCuller::CullEarly(const glm::mat4 &viewProjection) {
+    dispatch(EARLY, viewProjection, NULL, viewProjection);
+}
+
+void GpuCuller::CullLate(const glm::mat4 &viewProjection, HiZPyramid *hiZ) {
+    dispatch(LATE, viewProjection, hiZ, viewProjection);
+}
+
+void GpuCuller::dispatch(Phase            phase,
+                         const glm::mat4 &viewProjection,
+                         HiZPyramid      *hiZ,
+                         const glm::mat4 &hiZViewProjection) {
+    if (instances.empty()) {
+        return;
+    }
+
+    activeDraws = (phase == LATE) ? 1 : 0;
+
+    // Reset instance counts from the template without a CPU round trip
+    glBindBuffer(GL_COPY_READ_BUFFER, drawTemplateBuffers[activeDraws]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, drawBuffers[activeDraws]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        0,
+                        0,
+                        draws.size() * sizeof(DrawCommand));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    Frustum frustum(viewProjection);
+
+    cull.use();
+    cull.setInt("phase", phase);
+    glUniform1ui(glGetUniformLocation(cull.ID, "instanceCount"), instances.size());
+    glUniform4fv(glGetUniformLocation(cull.ID, "frustumPlanes"),
+                 6,
+                 glm::value_ptr(frustum.planes[0]));
+    cull.setBool("useHiZ", hiZ != NULL);
+
+    if (hiZ != NULL) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hiZ->GetTexture());
+        cull.setInt("hiZ", 0);
+        cull.setInt("hiZLevels", hiZ->GetLevels());
+        glUniformMatrix4fv(glGetUniformLocation(cull.ID, "hiZViewProjection"),
+                           1,
+                           GL_FALSE,
+                           glm::value_ptr(hiZViewProjection));
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, drawBuffers[activeDraws]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visibleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, visibilityBuffer);
+
+    glDispatchCompute((instances.size() + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                    GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuCuller::Draw() {
+    if (instances.empty()) {
+        return;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstanceBinding, instanceBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawBuffers[activeDraws]);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void *)0, draws.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+unsigned int GpuCuller::GetInstanceCount() {
+    return instances.size();
+}
+
+unsigned int GpuCuller::ReadVisibleCount() {
+    std::vector<DrawCommand> result(draws.size());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffers[activeDraws]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                       0,
+                       result.size() * sizeof(DrawCommand),
+                       result.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    unsigned int visible = 0;
+    for (unsigned int i = 0; i < result.size(); i++) {
+        visible += result[i].instanceCount;
+    }
+    return visible;
+}
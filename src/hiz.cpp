@@ -0,0 +1,136 @@
+#include <hiz.hpp>
+
+#include <algorithm>
+
+HiZPyramid::HiZPyramid(int width, int height)
+    : downsample("shaders/culling/fullscreen.vert", "shaders/culling/hiz.frag") {
+    this->width  = width;
+    this->height = height;
+
+    glGenFramebuffers(1, &framebuffer);
+    glGenVertexArrays(1, &vao);
+
+    create();
+}
+
+HiZPyramid::~HiZPyramid() {
+    glDeleteTextures(1, &texture);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(downsample.ID);
+}
+
+void HiZPyramid::Resize(int width, int height) {
+    if (width == this->width && height == this->height) {
+        return;
+    }
+
+    this->width  = width;
+    this->height = height;
+
+    glDeleteTextures(1, &texture);
+    create();
+}
+
+void HiZPyramid::Build(unsigned int depthTexture) {
+    GLint     viewport[4], previousFramebuffer;
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend     = glIsEnabled(GL_BLEND);
+    GLboolean cullFace  = glIsEnabled(GL_CULL_FACE);
+
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindVertexArray(vao);
+    downsample.use();
+    downsample.setInt("src", 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int level = 0; level < levels; level++) {
+        int srcWidth  = std::max(1, width >> std::max(0, level - 1));
+        int srcHeight = std::max(1, height >> std::max(0, level - 1));
+
+        if (level == 0) {
+            glBindTexture(GL_TEXTURE_2D, depthTexture);
+        } else {
+            // Only expose the level being read so reading and writing the same
+            // texture does not form a feedback loop
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        }
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, level);
+        glViewport(0, 0, std::max(1, width >> level), std::max(1, height >> level));
+
+        downsample.setBool("downsample", level > 0);
+        glUniform2i(glGetUniformLocation(downsample.ID, "srcSize"), srcWidth, srcHeight);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+    if (cullFace) {
+        glEnable(GL_CULL_FACE);
+    }
+}
+
+unsigned int HiZPyramid::GetTexture() {
+    return texture;
+}
+
+int HiZPyramid::GetWidth() {
+    return width;
+}
+
+int HiZPyramid::GetHeight() {
+    return height;
+}
+
+int HiZPyramid::GetLevels() {
+    return levels;
+}
+
+void HiZPyramid::create() {
+    levels = 1;
+    while ((std::max(width, height) >> levels) > 0) {
+        levels++;
+    }
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    for (int level = 0; level < levels; level++) {
+        glTexImage2D(GL_TEXTURE_2D,
+                     level,
+                     GL_R32F,
+                     std::max(1, width >> level),
+                     std::max(1, height >> level),
+                     0,
+                     GL_RED,
+                     GL_FLOAT,
+                     NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
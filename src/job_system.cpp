@@ -0,0 +1,357 @@
+#include <job_system.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct JobCounter::Job {
+    std::function<void()> work;
+    JobCounter           *counter;
+};
+
+std::vector<JobSystem::Worker *> JobSystem::workers;
+std::atomic<bool>                JobSystem::running(false);
+std::atomic<int>                 JobSystem::queued(0);
+std::atomic<int>                 JobSystem::sleeping(0);
+std::mutex                       JobSystem::sleepLock;
+std::condition_variable          JobSystem::wake;
+
+// Worker index of the calling thread, -1 outside the job system
+static thread_local int workerIndex = -1;
+
+static unsigned long long elapsedNs(std::chrono::steady_clock::time_point start,
+                                    std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+static void pinThread(std::thread::native_handle_type thread, unsigned int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+#endif
+}
+
+JobCounter::JobCounter() : count(0) {
+    lock.clear();
+}
+
+int JobCounter::Get() const {
+    return count.load(std::memory_order_acquire);
+}
+
+void JobCounter::acquire() {
+    while (lock.test_and_set(std::memory_order_acquire)) {
+    }
+}
+
+void JobCounter::release() {
+    lock.clear(std::memory_order_release);
+}
+
+void JobSystem::Start(unsigned int threads, bool pin) {
+    if (running) {
+        return;
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < threads; i++) {
+        Worker *worker       = new Worker();
+        worker->random       = 2654435761u * (i + 1);
+        worker->jobs         = 0;
+        worker->steals       = 0;
+        worker->failedSteals = 0;
+        worker->busyNs       = 0;
+        worker->idleNs       = 0;
+        workers.push_back(worker);
+    }
+
+    running     = true;
+    workerIndex = 0;
+    for (unsigned int i = 1; i < threads; i++) {
+        workers[i]->thread = std::thread(run, i);
+    }
+
+#ifdef __linux__
+    if (pin) {
+        pinThread(pthread_self(), 0);
+        for (unsigned int i = 1; i < threads; i++) {
+            pinThread(workers[i]->thread.native_handle(), i);
+        }
+    }
+#endif
+}
+
+void JobSystem::Stop() {
+    if (!running) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        running = false;
+    }
+    wake.notify_all();
+
+    for (unsigned int i = 1; i < workers.size(); i++) {
+        workers[i]->thread.join();
+    }
+
+    // Whatever is still queued runs here
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        while (Job *job = workers[i]->deque.Pop()) {
+            queued--;
+            execute(job, -1);
+        }
+    }
+
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        delete workers[i];
+    }
+    workers.clear();
+    workerIndex = -1;
+}
+
+unsigned int JobSystem::GetWorkerCount() {
+    return running ? workers.size() : 1;
+}
+
+int JobSystem::GetWorkerIndex() {
+    return running ? workerIndex : -1;
+}
+
+void JobSystem::Run(std::function<void()> work, JobCounter *counter) {
+    Job *job     = new Job();
+    job->work    = std::move(work);
+    job->counter = counter;
+
+    if (counter) {
+        counter->count.fetch_add(1);
+    }
+    push(job);
+}
+
+void JobSystem::RunAfter(JobCounter &dependency, std::function<void()> work, JobCounter *counter) {
+    Job *job     = new Job();
+    job->work    = std::move(work);
+    job->counter = counter;
+
+    if (counter) {
+        counter->count.fetch_add(1);
+    }
+
+    // finish() takes the waiting list under the same lock after the count
+    // drops to zero, so the job is either released by it or pushed here
+    dependency.acquire();
+    if (dependency.count.load() > 0) {
+        dependency.waiting.push_back(job);
+        job = NULL;
+    }
+    dependency.release();
+
+    if (job) {
+        push(job);
+    }
+}
+
+void JobSystem::Wait(JobCounter &counter) {
+    bool               helping = workerIndex >= 0 && running;
+    unsigned long long busy    = helping ? workers[workerIndex]->busyNs.load() : 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (counter.Get() > 0) {
+        Job *job = helping ? find(workerIndex) : NULL;
+        if (job) {
+            execute(job, workerIndex);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    counter.acquire();
+    counter.release();
+
+    // Other workers account their own idle time
+    if (helping && workerIndex == 0) {
+        unsigned long long waited = elapsedNs(start, std::chrono::steady_clock::now());
+        workers[0]->idleNs += waited - (workers[0]->busyNs - busy);
+    }
+}
+
+void JobSystem::ParallelFor(int                                  begin,
+                            int                                  end,
+                            int                                  grain,
+                            const std::function<void(int, int)> &body) {
+    if (begin >= end) {
+        return;
+    }
+
+    JobCounter counter;
+    parallelFor(begin, end, std::max(1, grain), body, counter);
+    Wait(counter);
+}
+
+std::vector<JobStats> JobSystem::GetStats() {
+    std::vector<JobStats> stats(workers.size());
+
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        stats[i].jobs         = workers[i]->jobs;
+        stats[i].steals       = workers[i]->steals;
+        stats[i].failedSteals = workers[i]->failedSteals;
+        stats[i].busyMs       = workers[i]->busyNs / 1e6f;
+        stats[i].idleMs       = workers[i]->idleNs / 1e6f;
+    }
+    return stats;
+}
+
+void JobSystem::ResetStats() {
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i]->jobs         = 0;
+        workers[i]->steals       = 0;
+        workers[i]->failedSteals = 0;
+        workers[i]->busyNs       = 0;
+        workers[i]->idleNs       = 0;
+    }
+}
+
+void JobSystem::push(Job *job) {
+    if (workerIndex < 0 || !running || !workers[workerIndex]->deque.Push(job)) {
+        execute(job, workerIndex < 0 || !running ? -1 : workerIndex);
+        return;
+    }
+
+    queued++;
+    if (sleeping > 0) {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        wake.notify_one();
+    }
+}
+
+JobSystem::Job *JobSystem::find(unsigned int index) {
+    Worker *self = workers[index];
+
+    Job *job = self->deque.Pop();
+    if (job) {
+        queued--;
+        return job;
+    }
+
+    unsigned int count = workers.size();
+    for (unsigned int attempt = 1; attempt < count; attempt++) {
+        // xorshift, random victims keep thieves from piling onto one worker
+        self->random ^= self->random << 13;
+        self->random ^= self->random >> 17;
+        self->random ^= self->random << 5;
+
+        unsigned int victim = self->random % count;
+        if (victim == index) {
+            continue;
+        }
+
+        job = workers[victim]->deque.Steal();
+        if (job) {
+            queued--;
+            self->steals++;
+            return job;
+        }
+        self->failedSteals++;
+    }
+
+    return NULL;
+}
+
+void JobSystem::execute(Job *job, int index) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    job->work();
+
+    if (index >= 0) {
+        workers[index]->jobs++;
+        workers[index]->busyNs += elapsedNs(start, std::chrono::steady_clock::now());
+    }
+
+    finish(job->counter);
+    delete job;
+}
+
+// The count only drops under the lock, so Wait() can take the lock to be
+// sure the last finish() is done with the counter before it goes away
+void JobSystem::finish(JobCounter *counter) {
+    if (!counter) {
+        return;
+    }
+
+    std::vector<Job *> released;
+    counter->acquire();
+    if (counter->count.fetch_sub(1) == 1) {
+        released.swap(counter->waiting);
+    }
+    counter->release();
+
+    for (unsigned int i = 0; i < released.size(); i++) {
+        push(released[i]);
+    }
+}
+
+void JobSystem::run(unsigned int index) {
+    workerIndex = index;
+
+    Worker                               *self   = workers[index];
+    unsigned int                          rounds = 0;
+    std::chrono::steady_clock::time_point idle   = std::chrono::steady_clock::now();
+
+    while (running) {
+        Job *job = find(index);
+        if (job) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            self->idleNs += elapsedNs(idle, now);
+
+            execute(job, index);
+            idle   = std::chrono::steady_clock::now();
+            rounds = 0;
+            continue;
+        }
+
+        if (++rounds < SpinRounds) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Push() only notifies when someone sleeps and sleeping is raised
+        // before the queue is checked, so a job queued now is not missed
+        std::unique_lock<std::mutex> guard(sleepLock);
+        sleeping++;
+        wake.wait(guard, []() { return queued > 0 || !running; });
+        sleeping--;
+        rounds = 0;
+    }
+
+    self->idleNs += elapsedNs(idle, std::chrono::steady_clock::now());
+}
+
+void JobSystem::parallelFor(int                                  first,
+                            int                                  last,
+                            int                                  grain,
+                            const std::function<void(int, int)> &body,
+                            JobCounter                          &counter) {
+    // The upper half goes to the deque for thieves, the lower half is split
+    // again here until it fits in one range
+    while (last - first > grain) {
+        int middle = first + (last - first) / 2;
+        auto upper = [middle, last, grain, &body, &counter]() {
+            parallelFor(middle, last, grain, body, counter);
+        };
+        Run(upper, &counter);
+        last = middle;
+    }
+
+    body(first, last);
+}
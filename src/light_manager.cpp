@@ -0,0 +1,268 @@
+#include <light_manager.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Lights covering more cells than this are tested against every object
+static const int MaxCellsPerLight = 64;
+
+LightManager::LightManager(float cellSize) {
+    this->cellSize   = cellSize;
+    this->stats      = LightManagerStats();
+    this->visitStamp = 0;
+
+    directional = {glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f)};
+}
+
+void LightManager::SetDirectionalLight(const DirectionalLight &light) {
+    directional = light;
+}
+
+const DirectionalLight &LightManager::GetDirectionalLight() {
+    return directional;
+}
+
+unsigned int LightManager::AddPointLight(const PointLight &light) {
+    pointLights.push_back(light);
+    return pointLights.size() - 1;
+}
+
+std::vector<PointLight> &LightManager::GetPointLights() {
+    return pointLights;
+}
+
+unsigned int LightManager::AddObject(const AABB &bounds) {
+    Object object;
+    object.bounds = bounds;
+    object.center = bounds.Center();
+    object.radius = glm::length(bounds.Extents());
+    objects.push_back(object);
+    return objects.size() - 1;
+}
+
+void LightManager::SetTransform(unsigned int object, const glm::mat4 &model) {
+    AABB world = objects[object].bounds.Transform(model);
+
+    objects[object].center = world.Center();
+    objects[object].radius = glm::length(world.Extents());
+}
+
+void LightManager::Update() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    stats = LightManagerStats();
+
+    buildGrid();
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        assign(objects[i]);
+        stats.lightsAssigned += objects[i].lights.size();
+    }
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    stats.objects  = objects.size();
+    stats.assignMs = elapsed.count();
+}
+
+void LightManager::Bind(Shader &shader, unsigned int object) {
+    const std::vector<unsigned int> &lights = objects[object].lights;
+
+    // Same four texels per light as the clustered path
+    packed.resize(std::max<size_t>(1, lights.size() * 4));
+    for (unsigned int i = 0; i < lights.size(); i++) {
+        const PointLight &light = pointLights[lights[i]];
+
+        packed[i * 4 + 0] = glm::vec4(light.position, radii[lights[i]]);
+        packed[i * 4 + 1] = glm::vec4(light.ambient, light.constant);
+        packed[i * 4 + 2] = glm::vec4(light.diffuse, light.linear);
+        packed[i * 4 + 3] = glm::vec4(light.specular, light.quadratic);
+    }
+
+    shader.setVec3("dLight.direction", directional.direction);
+    shader.setVec3("dLight.ambient", directional.ambient);
+    shader.setVec3("dLight.diffuse", directional.diffuse);
+    shader.setVec3("dLight.specular", directional.specular);
+    shader.setInt("lightCount", lights.size());
+    if (!lights.empty()) {
+        glUniform4fv(glGetUniformLocation(shader.ID, "lightList"),
+                     lights.size() * 4,
+                     &packed[0][0]);
+    }
+}
+
+LightManagerStats LightManager::GetStats() {
+    return stats;
+}
+
+void LightManager::buildGrid() {
+    grid.clear();
+    unbucketed.clear();
+    radii.resize(pointLights.size());
+    visited.assign(pointLights.size(), 0);
+    visitStamp = 0;
+
+    for (unsigned int i = 0; i < pointLights.size(); i++) {
+        radii[i] = pointLights[i].Radius();
+
+        glm::vec3 lo   = glm::floor((pointLights[i].position - radii[i]) / cellSize);
+        glm::vec3 hi   = glm::floor((pointLights[i].position + radii[i]) / cellSize);
+        glm::vec3 span = hi - lo + 1.0f;
+
+        if (span.x * span.y * span.z > MaxCellsPerLight) {
+            unbucketed.push_back(i);
+            continue;
+        }
+
+        for (int z = (int)lo.z; z <= (int)hi.z; z++) {
+            for (int y = (int)lo.y; y <= (int)hi.y; y++) {
+                for (int x = (int)lo.x; x <= (int)hi.x; x++) {
+                    grid.push_back(std::make_pair(cellKey(x, y, z), i));
+                }
+            }
+        }
+    }
+
+    std::sort(grid.begin(), grid.end());
+}
+
+void LightManager::assign(Object &object) {
+    visitStamp++;
+    candidates.clear();
+
+    for (unsigned int i = 0; i < unbucketed.size(); i++) {
+        addCandidate(unbucketed[i]);
+    }
+
+    glm::vec3 lo   = glm::floor((object.center - object.radius) / cellSize);
+    glm::vec3 hi   = glm::floor((object.center + object.radius) / cellSize);
+    glm::vec3 span = hi - lo + 1.0f;
+
+    if (span.x * span.y * span.z > grid.size()) {
+        // Walking the cells would cost more than walking the lights
+        for (unsigned int i = 0; i < grid.size(); i++) {
+            addCandidate(grid[i].second);
+        }
+    } else {
+        for (int z = (int)lo.z; z <= (int)hi.z; z++) {
+            for (int y = (int)lo.y; y <= (int)hi.y; y++) {
+                for (int x = (int)lo.x; x <= (int)hi.x; x++) {
+                    std::pair<unsigned long long, unsigned int> first(cellKey(x, y, z), 0);
+                    std::vector<std::pair<unsigned long long, unsigned int>>::iterator it =
+                        std::lower_bound(grid.begin(), grid.end(), first);
+                    for (; it != grid.end() && it->first == first.first; ++it) {
+                        addCandidate(it->second);
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned int count = candidates.size();
+    stats.lightsTested += count;
+
+    candidateX.clear();
+    candidateY.clear();
+    candidateZ.clear();
+    candidateRange.clear();
+    constant.clear();
+    linear.clear();
+    quadratic.clear();
+    brightness.clear();
+
+    for (unsigned int i = 0; i < count; i++) {
+        const PointLight &light = pointLights[candidates[i]];
+
+        candidateX.push_back(light.position.x);
+        candidateY.push_back(light.position.y);
+        candidateZ.push_back(light.position.z);
+        candidateRange.push_back(radii[candidates[i]]);
+        constant.push_back(light.constant);
+        linear.push_back(light.linear);
+        quadratic.push_back(light.quadratic);
+        brightness.push_back(std::max(light.diffuse.x, std::max(light.diffuse.y, light.diffuse.z)));
+    }
+
+    // Padding never passes the range test
+    while (candidateX.size() % 4 != 0) {
+        candidateX.push_back(0.0f);
+        candidateY.push_back(0.0f);
+        candidateZ.push_back(0.0f);
+        candidateRange.push_back(-1.0f);
+        constant.push_back(1.0f);
+        linear.push_back(0.0f);
+        quadratic.push_back(0.0f);
+        brightness.push_back(0.0f);
+    }
+
+    ranked.clear();
+
+    // Influence is the light's attenuated brightness at the nearest point of
+    // the object's bounding sphere, zero once that point is out of range
+    for (unsigned int j = 0; j < candidateX.size(); j += 4) {
+        float influence[4];
+
+#ifdef __SSE2__
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&candidateX[j]), _mm_set1_ps(object.center.x));
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&candidateY[j]), _mm_set1_ps(object.center.y));
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(&candidateZ[j]), _mm_set1_ps(object.center.z));
+        __m128 d  = _mm_sqrt_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        __m128 s  = _mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(d, _mm_set1_ps(object.radius)));
+
+        __m128 falloff     = _mm_add_ps(_mm_loadu_ps(&linear[j]),
+                                        _mm_mul_ps(s, _mm_loadu_ps(&quadratic[j])));
+        __m128 attenuation = _mm_add_ps(_mm_loadu_ps(&constant[j]), _mm_mul_ps(s, falloff));
+        __m128 inRange     = _mm_cmple_ps(s, _mm_loadu_ps(&candidateRange[j]));
+
+        _mm_storeu_ps(influence,
+                      _mm_and_ps(inRange, _mm_div_ps(_mm_loadu_ps(&brightness[j]), attenuation)));
+#else
+        for (int k = 0; k < 4; k++) {
+            glm::vec3 light(candidateX[j + k], candidateY[j + k], candidateZ[j + k]);
+            float     s = std::max(0.0f, glm::length(light - object.center) - object.radius);
+
+            influence[k] = s <= candidateRange[j + k]
+                               ? brightness[j + k] /
+                                     (constant[j + k] + s * (linear[j + k] + s * quadratic[j + k]))
+                               : 0.0f;
+        }
+#endif
+
+        for (int k = 0; k < 4 && j + k < count; k++) {
+            if (influence[k] > 0.0f) {
+                ranked.push_back(std::make_pair(influence[k], candidates[j + k]));
+            }
+        }
+    }
+
+    unsigned int keep = std::min<size_t>(MaxLightsPerObject, ranked.size());
+    std::partial_sort(ranked.begin(),
+                      ranked.begin() + keep,
+                      ranked.end(),
+                      std::greater<std::pair<float, unsigned int>>());
+
+    object.lights.clear();
+    for (unsigned int i = 0; i < keep; i++) {
+        object.lights.push_back(ranked[i].second);
+    }
+}
+
+void LightManager::addCandidate(unsigned int light) {
+    if (visited[light] != visitStamp) {
+        visited[light] = visitStamp;
+        candidates.push_back(light);
+    }
+}
+
+unsigned long long LightManager::cellKey(int x, int y, int z) {
+    // 21 bits per axis, offset so negative cells stay positive
+    const unsigned long long bias = 1 << 20;
+    const unsigned long long mask = (1 << 21) - 1;
+
+    return (((x + bias) & mask) << 42) | (((y + bias) & mask) << 21) | ((z + bias) & mask);
+}
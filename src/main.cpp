@@ -1,12 +1,29 @@
 #include <SDL_video.h>
+#include <atomic>
 #include <cmath>
-#include <map>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <glad/glad.h>
 
 #include <camera.hpp>
+#include <clustered_lights.hpp>
+#include <command_buffer.hpp>
+#include <deferred.hpp>
+#include <depth_prepass.hpp>
+#include <draw_list.hpp>
+#include <frame_sync.hpp>
+#include <framebuffer.hpp>
+#include <gpu_culler.hpp>
+#include <hiz.hpp>
+#include <job_system.hpp>
+#include <light_manager.hpp>
 #include <shader.hpp>
+#include <shader_manager.hpp>
+#include <shader_source.hpp>
+#include <shader_variants.hpp>
+#include <timestep.hpp>
 
 #include <SDL.h>
 #include <glm.hpp>
@@ -15,34 +32,40 @@
 #include <gtc/type_ptr.hpp>
 
 #include <model.hpp>
+#include <occlusion.hpp>
+#include <occlusion_query.hpp>
+#include <render_thread.hpp>
+#include <resource_loader.hpp>
+#include <ring_buffer.hpp>
 #include <stb_image.h>
 
 #include <texture.hpp>
+#include <uniform_blocks.hpp>
+#include <upload_manager.hpp>
+#include <upload_scheduler.hpp>
+#include <visibility_buffer.hpp>
 
 const int screenHeight = 720;
 const int screenWidth  = 1280;
 
-float  deltaTime = 0.0f;
-Uint64 lastFrame = 0;
-
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 
 bool firstMouse = true;
 
-void process_input() {
+void process_input(float step) {
     const Uint8 *keys = SDL_GetKeyboardState(NULL);
 
     if (keys[SDL_GetScancodeFromKey(SDLK_w)]) {
-        camera.ProcessKeyboard(FORWARD, deltaTime);
+        camera.ProcessKeyboard(FORWARD, step);
     }
     if (keys[SDL_GetScancodeFromKey(SDLK_s)]) {
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
+        camera.ProcessKeyboard(BACKWARD, step);
     }
     if (keys[SDL_GetScancodeFromKey(SDLK_a)]) {
-        camera.ProcessKeyboard(LEFT, deltaTime);
+        camera.ProcessKeyboard(LEFT, step);
     }
     if (keys[SDL_GetScancodeFromKey(SDLK_d)]) {
-        camera.ProcessKeyboard(RIGHT, deltaTime);
+        camera.ProcessKeyboard(RIGHT, step);
     }
 }
 
@@ -62,6 +85,42 @@ void logGlInit() {
     printf("Context  : %d.%d\n\n", maj, min);
 }
 
+// Uniforms shared by every shader following model.frag's lighting layout
+void setModelLights(Shader                        &shader,
+                    const DirectionalLight        &sun,
+                    const std::vector<PointLight> &pointLights,
+                    unsigned int                   count) {
+    shader.use();
+    shader.setFloat("shininess", 32.0f);
+    shader.setVec3("dLight.direction", sun.direction);
+    shader.setVec3("dLight.ambient", sun.ambient);
+    shader.setVec3("dLight.diffuse", sun.diffuse);
+    shader.setVec3("dLight.specular", sun.specular);
+
+    for (unsigned int i = 0; i < count; i++) {
+        std::string name = "pointLights[" + std::to_string(i) + "]";
+        shader.setVec3(name + ".position", pointLights[i].position);
+        shader.setVec3(name + ".ambient", pointLights[i].ambient);
+        shader.setVec3(name + ".diffuse", pointLights[i].diffuse);
+        shader.setVec3(name + ".specular", pointLights[i].specular);
+        shader.setFloat(name + ".constant", pointLights[i].constant);
+        shader.setFloat(name + ".linear", pointLights[i].linear);
+        shader.setFloat(name + ".quadratic", pointLights[i].quadratic);
+    }
+}
+
+enum ForwardLighting {
+    FIXED_LIGHTS,
+    OBJECT_LIGHTS,
+    CLUSTERED_LIGHTS
+};
+
+enum RenderPath {
+    FORWARD_PATH,
+    DEFERRED_PATH,
+    VISIBILITY_PATH
+};
+
 #define ASSERT_SDL_SUCCESS(x)                                                  \
     if ((x) != 0) {                                                            \
         printf("SDL Error: %s (%s:%d)\n", SDL_GetError(), __FILE__, __LINE__); \
@@ -69,7 +128,35 @@ void logGlInit() {
     }
 
 int main(int argc, char **argv) {
-    bool running = true;
+    bool running      = true;
+    bool loaderThread = false;
+    bool pinThreads   = false;
+    // Simulation steps and rendered frames per second, 0 renders uncapped
+    float simRate    = 60.0f;
+    float renderRate = 0.0f;
+    // Draw only when something changed, for viewers left open
+    bool onDemand = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loader-thread") == 0) {
+            loaderThread = true;
+        }
+        if (strcmp(argv[i], "--pin-threads") == 0) {
+            pinThreads = true;
+        }
+        if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc) {
+            simRate = atof(argv[++i]);
+        }
+        if (strcmp(argv[i], "--render-rate") == 0 && i + 1 < argc) {
+            renderRate = atof(argv[++i]);
+        }
+        if (strcmp(argv[i], "--on-demand") == 0) {
+            onDemand = true;
+        }
+    }
+
+    // One worker per core for model import, image decoding and culling
+    JobSystem::Start(0, pinThreads);
+
     ASSERT_SDL_SUCCESS(SDL_Init(SDL_INIT_VIDEO));
 
     SDL_Window *window = NULL;
@@ -83,13 +170,23 @@ int main(int argc, char **argv) {
         return -1;
     }
 
-    ASSERT_SDL_SUCCESS(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3));
+    ASSERT_SDL_SUCCESS(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4));
     ASSERT_SDL_SUCCESS(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3));
     ASSERT_SDL_SUCCESS(
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE));
     ASSERT_SDL_SUCCESS(SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1));
 
     SDL_GLContext context = SDL_GL_CreateContext(window);
+    if (context == NULL) {
+        // Only the GPU-driven paths need 4.3, everything else runs on 3.3
+        ASSERT_SDL_SUCCESS(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3));
+        ASSERT_SDL_SUCCESS(SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3));
+        context = SDL_GL_CreateContext(window);
+    }
+    if (context == NULL) {
+        printf("Error creating GL context: %s\n", SDL_GetError());
+        return -1;
+    }
 
     if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
         printf("Failed to iniailize GLAD\n");
@@ -98,6 +195,12 @@ int main(int argc, char **argv) {
 
     logGlInit();
 
+    // With --loader-thread textures and model buffers are created on a
+    // second, shared context and appear once ready; the scene keeps rendering
+    if (loaderThread && !ResourceLoader::Start(window)) {
+        printf("Loading on the main thread\n");
+    }
+
     if (SDL_SetRelativeMouseMode(SDL_TRUE) != 0) {
         printf("Error capturing mouse: %s\n", SDL_GetError());
     }
@@ -229,9 +332,252 @@ int main(int argc, char **argv) {
 
     // End Windows
 
+    AABB floorBounds  = AABB::FromPositions(planeVertexData, 4, 5);
+    AABB cubeBounds   = AABB::FromPositions(cubeVertexData, 8, 5);
+    AABB windowBounds = AABB::FromPositions(windowVertexData, 4, 5);
+
+    // The cubes double as the occluders for everything else in the scene
+    OcclusionCuller occlusion;
+    bool            occlusionCulling = true;
+
+    // The scene renders offscreen so its depth can feed the Hi-Z pyramid
+    int         windowWidth = screenWidth, windowHeight = screenHeight;
+    Framebuffer sceneTarget(screenWidth, screenHeight, {GL_RGBA8});
+    HiZPyramid  hiZ(screenWidth, screenHeight);
+
+    // GPU-driven cubes: the scene cubes plus a field of cubes below the floor
+    Shader    *instancedShader = NULL;
+    GpuCuller *gpuCuller       = NULL;
+    bool       gpuCulling      = false;
+    const int  cubeFieldSize   = 64;
+    if (GpuCuller::IsSupported()) {
+        gpuCuller = new GpuCuller();
+        instancedShader =
+            new Shader("shaders/culling/instanced.vert", "shaders/texture/basic.frag");
+
+        unsigned int cubeDraw =
+            gpuCuller->AddDraw(sizeof(cubeIndices) / sizeof(cubeIndices[0]), 0, 0);
+        for (int i = 0; i < 2; i++) {
+            gpuCuller->AddInstance(cubeDraw,
+                                   glm::translate(glm::mat4(1.0f), cubePositions[i]),
+                                   cubeBounds);
+        }
+        for (int x = 0; x < cubeFieldSize; x++) {
+            for (int z = 0; z < cubeFieldSize; z++) {
+                glm::vec3 position((x - cubeFieldSize / 2) * 3.0f,
+                                   -3.0f,
+                                   (z - cubeFieldSize / 2) * 3.0f);
+                gpuCuller->AddInstance(cubeDraw,
+                                       glm::translate(glm::mat4(1.0f), position),
+                                       cubeBounds);
+            }
+        }
+        gpuCuller->Upload();
+        gpuCuller->BindInstanceAttribute(cubeVAO, 3);
+    }
+
+    // Model variants compile in the background while the nanosuit loads and
+    // draw with the fallback until they are ready
+    ShaderManager  shaderManager("shaders/model/model.vert", "shaders/model/fallback.frag");
+    ShaderVariants modelVariants(
+        "shaders/model/model.vert", "shaders/model/model.frag", &shaderManager);
+
+    DirectionalLight sun = {glm::vec3(-0.2f, -1.0f, -0.3f),
+                            glm::vec3(0.2f),
+                            glm::vec3(0.5f),
+                            glm::vec3(1.0f)};
+
+    // Every lighting path reads its lights from here
+    LightManager lightManager;
+    lightManager.SetDirectionalLight(sun);
+
+    glm::vec3 pointLightPositions[] = {glm::vec3(0.7f, 0.2f, 2.0f), glm::vec3(-2.0f, 1.0f, -3.0f)};
+    for (int i = 0; i < 2; i++) {
+        PointLight light = {pointLightPositions[i],
+                            glm::vec3(0.05f),
+                            glm::vec3(0.8f),
+                            glm::vec3(1.0f),
+                            1.0f,
+                            0.09f,
+                            0.032f};
+        lightManager.AddPointLight(light);
+    }
+    std::vector<PointLight> &pointLights = lightManager.GetPointLights();
+
+    // model.frag is specialized per material; every variant gets the two
+    // static lights when it is first compiled
+    const unsigned int fixedLightsKey = ShaderVariants::Key(0, 2);
+    modelVariants.SetInitializer(
+        [&](Shader &shader) { setModelLights(shader, sun, pointLights, 2); });
+    modelVariants.Prewarm({fixedLightsKey,
+                           fixedLightsKey | VARIANT_SPECULAR_MAP,
+                           fixedLightsKey | VARIANT_ALPHA_TEST,
+                           fixedLightsKey | VARIANT_SPECULAR_MAP | VARIANT_ALPHA_TEST});
+
+    // Many-light forward paths: the two lights above plus small coloured
+    // lights orbiting the scene, far more than model.frag's fixed array holds.
+    // Per-object lists pick the strongest few, clusters keep them all.
+    auto setAllLights = [&](Shader &shader) { setModelLights(shader, sun, pointLights, 0); };
+
+    unsigned int lightListProgram = shaderManager.Submit(
+        "shaders/model/model.vert", "shaders/model/lightlist.frag", "", setAllLights);
+    unsigned int clusteredProgram = shaderManager.Submit(
+        "shaders/model/model.vert", "shaders/model/clustered.frag", "", setAllLights);
+
+    // Edits under shaders/model rebuild the affected programs in place
+    shaderManager.WatchForChanges();
+
+    // Nanosuit, mostly hidden behind the left cube from the starting position
+    Model nanosuit("models/nanosuit/nanosuit.obj");
+
+    glm::mat4 nanosuitModel = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, -0.51f, -2.5f));
+    nanosuitModel           = glm::scale(nanosuitModel, glm::vec3(0.06f));
+
+    // Frames in flight; the CPU waits at the start of a frame only when it
+    // gets this far ahead of the GPU
+    FrameSync frameSync(3);
+
+    // Per-draw Transforms blocks for model.vert and basic.vert, written
+    // straight into mapped memory and bound by range
+    RingBuffer drawData(GL_UNIFORM_BUFFER, 64 * 1024, frameSync);
+
+    unsigned int nanosuitLights = lightManager.AddObject(nanosuit.GetBounds());
+    lightManager.SetTransform(nanosuitLights, nanosuitModel);
+
+    const int       orbitingLights = 254;
+    ClusteredLights clustered(0.1f, 100.0f);
+    ForwardLighting forwardLighting = FIXED_LIGHTS;
+    for (int i = 0; i < orbitingLights; i++) {
+        float     hue = (float)i / orbitingLights * 6.0f;
+        glm::vec3 color(glm::clamp(std::fabs(hue - 3.0f) - 1.0f, 0.0f, 1.0f),
+                        glm::clamp(2.0f - std::fabs(hue - 2.0f), 0.0f, 1.0f),
+                        glm::clamp(2.0f - std::fabs(hue - 4.0f), 0.0f, 1.0f));
+        PointLight light = {
+            glm::vec3(0.0f), color * 0.02f, color * 0.6f, color * 0.6f, 1.0f, 0.7f, 1.8f};
+        lightManager.AddPointLight(light);
+    }
+
+    // Alternative renderers for the lit model: deferred shares the full light
+    // list, the visibility buffer resolves with model.frag's lights
+    DeferredRenderer deferred(screenWidth, screenHeight);
+    VisibilityBuffer visibilityBuffer(screenWidth, screenHeight);
+    unsigned int     nanosuitVisibility = visibilityBuffer.Add(nanosuit);
+    RenderPath       renderPath         = FORWARD_PATH;
+    visibilityBuffer.SetTransform(nanosuitVisibility, nanosuitModel);
+    setModelLights(visibilityBuffer.GetResolveShader(), sun, pointLights, 2);
+
+    // Opt-in hardware occlusion queries for the expensive model
+    OcclusionQueries occlusionQueries;
+    unsigned int     nanosuitQuery = occlusionQueries.Add(nanosuit.GetBounds());
+    bool             queryCulling  = true;
+
+    // Relative fragment cost: model.frag runs three lights over six fetches
+    DepthPrepass prepass;
+    unsigned int floorPrepass = prepass.Add(floorBounds, 1.0f, 2);
+    unsigned int cubePrepass[2];
+    for (int i = 0; i < 2; i++) {
+        cubePrepass[i] = prepass.Add(cubeBounds, 1.0f, 12);
+    }
+    unsigned int nanosuitPrepass =
+        prepass.Add(nanosuit.GetBounds(), 6.0f, nanosuit.GetTriangleCount());
+
+    // The textured objects, culled and sorted into a draw list every frame
+    DrawList drawList;
+    drawList.Add(floorBounds, floorVAO, &metal_tex, 6, DrawList::OPAQUE, floorPrepass);
+    unsigned int cubeDraws[2];
+    for (int i = 0; i < 2; i++) {
+        cubeDraws[i] =
+            drawList.Add(cubeBounds, cubeVAO, &marble_tex, 36, DrawList::OPAQUE, cubePrepass[i]);
+        drawList.SetTransform(cubeDraws[i], glm::translate(glm::mat4(1.0f), cubePositions[i]));
+    }
+    for (unsigned int i = 0; i < num_windows; i++) {
+        unsigned int windowDraw =
+            drawList.Add(windowBounds, windowVAO, &window_tex, 6, DrawList::TRANSPARENT);
+        drawList.SetTransform(windowDraw, glm::translate(glm::mat4(1.0f), windowPositions[i]));
+    }
+
+    printf("Program cache: %u hits, %u misses\n",
+           ProgramCache::GetHits(),
+           ProgramCache::GetMisses());
+    printf("Shader sources: %u file reads, %u stage compiles, %u stages reused\n",
+           ShaderSource::GetFileReads(),
+           ShaderSource::GetStageCompiles(),
+           ShaderSource::GetStageReuses());
+    printf("Shader manager: %u programs pending, parallel compile %s\n",
+           shaderManager.GetPendingCount(),
+           shaderManager.IsParallel() ? "on" : "off");
+
+    // GL belongs to the render thread from here on. This thread handles input
+    // and records frame N+1 while the render thread replays frame N; anything
+    // the render thread owns is reached through CommandBuffer::Call().
+    RenderThread renderThread(window, context, drawData);
+
+    // This thread's copies of the modes the render thread's objects hold
+    OcclusionQueries::Mode  queryMode   = occlusionQueries.GetMode();
+    DepthPrepass::Mode      prepassMode = prepass.GetMode();
+    std::vector<PointLight> frameLights = pointLights;
+
+    // Transforms for draws made from inside a Call()
+    auto uploadTransforms = [&drawData](const TransformsBlock &transforms) {
+        GLintptr offset;
+        void    *slice = drawData.Allocate(sizeof(TransformsBlock), offset);
+        if (slice) {
+            transforms.upload(slice);
+            drawData.BindRange(TransformsBlock::Binding, offset, sizeof(TransformsBlock));
+        }
+    };
+
+    // The camera moves and the lights orbit in fixed steps; each frame draws
+    // the scene interpolated between the last two steps
+    FixedTimestep timestep(simRate);
+    FrameLimiter  limiter(renderRate);
+    glm::vec3     previousPosition = camera.Position;
+
+    // Minimized or hidden windows draw nothing. With --on-demand a frame is
+    // drawn only while something changes: the camera, a key, the window,
+    // background loads and compiles, or the orbiting lights when they are
+    // lit. A few frames follow each change so the temporal culling and the
+    // frames in flight settle, after that the loop sleeps in
+    // SDL_WaitEventTimeout() and only wakes to poll background work.
+    const int          IdleTimeoutMs = 100;
+    const unsigned int SettleFrames  = 4;
+
+    Uint32            hiddenFlags = SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN;
+    bool              paused      = (SDL_GetWindowFlags(window) & hiddenFlags) != 0;
+    unsigned int      settle      = SettleFrames;
+    std::atomic<bool> background(false);
+    unsigned int      reloads = shaderManager.GetReloadCount();
+
+    auto idle = [&]() {
+        bool animating = renderPath == DEFERRED_PATH || forwardLighting != FIXED_LIGHTS;
+        return onDemand && settle == 0 && !animating && !background;
+    };
+
     SDL_Event event;
 
     while (running) {
+        if (paused || idle()) {
+            // Leaves the event in the queue for the loop below
+            SDL_WaitEventTimeout(NULL, IdleTimeoutMs);
+            timestep.Reset();
+        }
+
+        CommandBuffer &commands = renderThread.GetCommands();
+
+        commands.Call([&]() {
+            shaderManager.Poll();
+            UploadManager::Poll();
+            ResourceLoader::Poll();
+            // Also while paused, so uploads keep going behind a minimized window
+            UploadScheduler::Drain();
+
+            background = shaderManager.GetPendingCount() > 0 ||
+                         shaderManager.GetReloadCount() != reloads ||
+                         ResourceLoader::GetPendingCount() > 0 ||
+                         UploadScheduler::GetStats().queuedUploads > 0;
+            reloads = shaderManager.GetReloadCount();
+        });
+
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
                 running = false;
@@ -240,9 +586,22 @@ int main(int argc, char **argv) {
             if (event.type == SDL_WINDOWEVENT) {
                 switch (event.window.event) {
                     case SDL_WINDOWEVENT_RESIZED: {
-                        glViewport(0, 0, event.window.data1, event.window.data2);
+                        windowWidth  = event.window.data1;
+                        windowHeight = event.window.data2;
+
+                        int width = windowWidth, height = windowHeight;
+                        commands.Call([&, width, height]() {
+                            sceneTarget.Resize(width, height);
+                            hiZ.Resize(width, height);
+                            deferred.Resize(width, height);
+                            visibilityBuffer.Resize(width, height);
+                        });
                     }
                 }
+                // Backends differ in which event ends a minimize (restored,
+                // maximized, shown), the flags are always right
+                paused = (SDL_GetWindowFlags(window) & hiddenFlags) != 0;
+                settle = SettleFrames;
             }
 
             if (event.type == SDL_MOUSEMOTION) {
@@ -265,81 +624,423 @@ int main(int argc, char **argv) {
             }
 
             if (event.type == SDL_KEYDOWN) {
+                settle = SettleFrames;
+
                 if (event.key.keysym.sym == SDLK_ESCAPE) {
                     running = false;
                 }
+                if (event.key.keysym.sym == SDLK_o) {
+                    occlusionCulling = !occlusionCulling;
+                    printf("Occlusion culling: %s\n", occlusionCulling ? "on" : "off");
+                }
+                if (event.key.keysym.sym == SDLK_q) {
+                    // off -> conditional rendering -> temporal reuse -> off
+                    if (!queryCulling) {
+                        queryCulling = true;
+                        queryMode    = OcclusionQueries::CONDITIONAL;
+                    } else if (queryMode == OcclusionQueries::CONDITIONAL) {
+                        queryMode = OcclusionQueries::TEMPORAL;
+                    } else {
+                        queryCulling = false;
+                    }
+                    OcclusionQueries::Mode mode = queryMode;
+                    commands.Call([&occlusionQueries, mode]() { occlusionQueries.SetMode(mode); });
+                    printf("Occlusion queries: %s\n",
+                           !queryCulling                                ? "off"
+                           : queryMode == OcclusionQueries::CONDITIONAL ? "conditional"
+                                                                        : "temporal");
+                }
+                if (event.key.keysym.sym == SDLK_p) {
+                    prepassMode = prepassMode == DepthPrepass::OFF     ? DepthPrepass::EQUAL
+                                  : prepassMode == DepthPrepass::EQUAL ? DepthPrepass::LEQUAL
+                                                                       : DepthPrepass::OFF;
+
+                    // The stats are the render thread's, so is the switch
+                    DepthPrepass::Mode next = prepassMode;
+                    commands.Call([&prepass, next]() {
+                        DepthPrepassStats stats = prepass.GetStats();
+                        printf("Depth pre-pass: %u/%u objects, %llu of %llu fragments shaded\n",
+                               stats.prepassed,
+                               stats.objects,
+                               stats.shadedSamples,
+                               stats.depthSamples);
+
+                        prepass.SetMode(next);
+                        printf("Depth pre-pass: %s\n",
+                               next == DepthPrepass::OFF     ? "off"
+                               : next == DepthPrepass::EQUAL ? "GL_EQUAL"
+                                                             : "GL_LEQUAL");
+                    });
+                }
+                if (event.key.keysym.sym == SDLK_f) {
+                    commands.Call([&frameSync]() {
+                        FrameSyncStats stats = frameSync.GetStats();
+                        printf("Frame sync: %u in flight, %u of %u frames waited, "
+                               "%.3fms average, %.3fms max\n",
+                               stats.framesInFlight,
+                               stats.stalledFrames,
+                               stats.frames,
+                               stats.averageWaitMs,
+                               stats.maxWaitMs);
+                        frameSync.ResetStats();
+                    });
+
+                    RenderThreadStats stats  = renderThread.GetStats();
+                    float             frames = stats.frames ? (float)stats.frames : 1.0f;
+                    printf("Render thread: %u frames, %u commands (%ld bytes) last frame, "
+                           "%.3fms replay, %.3fms submit wait, %.3fms idle per frame\n",
+                           stats.frames,
+                           stats.commands,
+                           (long)stats.bytes,
+                           stats.replayMs / frames,
+                           stats.submitWaitMs / frames,
+                           stats.idleMs / frames);
+                    renderThread.ResetStats();
+                }
+                if (event.key.keysym.sym == SDLK_u) {
+                    commands.Call([]() {
+                        UploadStats stats = UploadScheduler::GetStats();
+                        printf("Uploads: %u queued (%ld bytes), %ld bytes in %.3fms last frame, "
+                               "last drain took %u frames\n",
+                               stats.queuedUploads,
+                               (long)stats.queuedBytes,
+                               (long)stats.bytesLastFrame,
+                               stats.msLastFrame,
+                               stats.lastDrainFrames);
+                        if (ResourceLoader::IsRunning()) {
+                            printf("Loader thread: %u pending, %u done\n",
+                                   ResourceLoader::GetPendingCount(),
+                                   ResourceLoader::GetCompletedCount());
+                        }
+                    });
+                }
+                if (event.key.keysym.sym == SDLK_j) {
+                    std::vector<JobStats> stats = JobSystem::GetStats();
+                    for (unsigned int i = 0; i < stats.size(); i++) {
+                        printf("Worker %2u: %llu jobs, %llu steals (%llu failed), "
+                               "%.1fms busy, %.1fms idle\n",
+                               i,
+                               stats[i].jobs,
+                               stats[i].steals,
+                               stats[i].failedSteals,
+                               stats[i].busyMs,
+                               stats[i].idleMs);
+                    }
+                    JobSystem::ResetStats();
+
+                    DrawListStats list = drawList.GetStats();
+                    printf("Draw list: %u/%u visible (%u outside the frustum, %u occluded), "
+                           "%.3fms build, %.3fms sort\n",
+                           list.visible,
+                           list.objects,
+                           list.frustumCulled,
+                           list.occlusionCulled,
+                           list.buildMs,
+                           list.sortMs);
+                }
+                if (event.key.keysym.sym == SDLK_c) {
+                    // model.frag's two lights -> per-object lists -> clusters
+                    if (forwardLighting == FIXED_LIGHTS) {
+                        forwardLighting = OBJECT_LIGHTS;
+                        printf("Forward lighting: per-object light lists\n");
+                    } else if (forwardLighting == OBJECT_LIGHTS) {
+                        forwardLighting = CLUSTERED_LIGHTS;
+                        commands.Call([&lightManager]() {
+                            LightManagerStats stats = lightManager.GetStats();
+                            printf("Light lists: %u objects, %u lights tested, %u assigned, "
+                                   "%.3fms\n",
+                                   stats.objects,
+                                   stats.lightsTested,
+                                   stats.lightsAssigned,
+                                   stats.assignMs);
+                            printf("Forward lighting: clustered\n");
+                        });
+                    } else {
+                        forwardLighting = FIXED_LIGHTS;
+                        commands.Call([&clustered]() {
+                            ClusterStats stats = clustered.GetStats();
+                            printf("Clusters: %u lights, %u clusters, %u indices, %.3fms\n",
+                                   stats.lights,
+                                   stats.activeClusters,
+                                   stats.indices,
+                                   stats.assignMs);
+                            printf("Forward lighting: fixed\n");
+                        });
+                    }
+                }
+                if (event.key.keysym.sym == SDLK_r) {
+                    // forward -> deferred -> visibility buffer -> forward
+                    renderPath = renderPath == FORWARD_PATH    ? DEFERRED_PATH
+                                 : renderPath == DEFERRED_PATH ? VISIBILITY_PATH
+                                                               : FORWARD_PATH;
+                    printf("Renderer: %s\n",
+                           renderPath == FORWARD_PATH    ? "forward"
+                           : renderPath == DEFERRED_PATH ? "deferred"
+                                                         : "visibility buffer");
+                }
+                if (event.key.keysym.sym == SDLK_g && gpuCuller != NULL) {
+                    gpuCulling = !gpuCulling;
+                    printf("GPU culling: %s\n", gpuCulling ? "on" : "off");
+                }
             }
         }
 
-        Uint64 frame_ticks = SDL_GetTicks();
-        deltaTime          = (float)(frame_ticks - lastFrame) / 1000.f;
-        lastFrame          = frame_ticks;
+        timestep.Advance();
+        while (timestep.Step()) {
+            previousPosition = camera.Position;
+            process_input(timestep.GetStep());
+        }
+
+        // Still moving until a step catches the interpolation up
+        if (camera.IsDirty() || background || previousPosition != camera.Position) {
+            camera.ClearDirty();
+            settle = SettleFrames;
+        }
+        if (paused || idle()) {
+            // Nothing to draw, the polls above still run
+            renderThread.Submit();
+            continue;
+        }
+        if (settle > 0) {
+            settle--;
+        }
+
+        commands.Call([&]() {
+            frameSync.BeginFrame();
+            drawData.BeginFrame();
+        });
 
-        process_input();
+        // Mouse look and zoom are applied as events arrive, only movement
+        // integrated over time is interpolated
+        float alpha = timestep.GetAlpha();
+        float time  = (float)(timestep.GetTime() - (1.0f - alpha) * timestep.GetStep());
 
-        glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        commands.Call([&sceneTarget]() { sceneTarget.Bind(); });
+        commands.Clear(glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
 
-        glEnable(GL_CULL_FACE);
+        commands.Enable(CommandBuffer::CULL_FACE);
 
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
                                                 (float)screenWidth / (float)screenHeight,
                                                 0.1f,
                                                 100.0f);
-        glm::mat4 view       = camera.GetViewMatrix();
-        glm::mat4 model(1.0f);
-
-        glActiveTexture(GL_TEXTURE0);
-
-        textureShader.use();
-
-        glBindVertexArray(floorVAO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, floorEBO);
-        glBindTexture(GL_TEXTURE_2D, metal_tex.GetID());
-        textureShader.setInt("tex", 0);
-        textureShader.setMat4("projection", projection);
-        textureShader.setMat4("view", view);
-        textureShader.setMat4("model", model);
-        glDrawElements(GL_TRIANGLES, sizeof(planeIndices), GL_UNSIGNED_INT, 0);
-
-        glBindVertexArray(cubeVAO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
-        glBindTexture(GL_TEXTURE_2D, marble_tex.GetID());
-        textureShader.setInt("tex", 0);
-        textureShader.setMat4("projection", projection);
-        textureShader.setMat4("view", view);
+        glm::vec3 viewPos    = glm::mix(previousPosition, camera.Position, alpha);
+        glm::mat4 view       = camera.GetViewMatrix(viewPos);
+        int       width = windowWidth, height = windowHeight;
+
+        auto transformsFor = [&](const glm::mat4 &objectModel) {
+            TransformsBlock transforms;
+            transforms.model      = objectModel;
+            transforms.view       = view;
+            transforms.projection = projection;
+            transforms.viewPos    = viewPos;
+            return transforms;
+        };
+        auto bindTransforms = [&](const glm::mat4 &objectModel) {
+            TransformsBlock transforms = transformsFor(objectModel);
+            commands.UniformBlock(TransformsBlock::Binding, &transforms, sizeof(transforms));
+        };
+
+        if (gpuCulling) {
+            glm::mat4 viewProjection = projection * view;
+            commands.Call([gpuCuller, viewProjection]() { gpuCuller->CullEarly(viewProjection); });
+        }
+
+        if (occlusionCulling) {
+            occlusion.Begin(projection * view);
+            for (int i = 0; i < 2; i++) {
+                occlusion.AddOccluder(cubeVertexData,
+                                      8,
+                                      5,
+                                      cubeIndices,
+                                      sizeof(cubeIndices) / sizeof(cubeIndices[0]),
+                                      glm::translate(glm::mat4(1.0f), cubePositions[i]));
+            }
+            occlusion.Rasterize();
+        }
+
         for (int i = 0; i < 2; i++) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            textureShader.setMat4("model", model);
-            glDrawElements(GL_TRIANGLES, sizeof(cubeIndices), GL_UNSIGNED_INT, 0);
+            drawList.SetEnabled(cubeDraws[i], !gpuCulling);
+        }
+        drawList.Build(projection * view, viewPos, occlusionCulling ? &occlusion : NULL);
+
+        // Replays part of the sorted list, binding only what changes
+        auto recordDraws = [&](unsigned int first, unsigned int last) {
+            const std::vector<DrawItem> &items = drawList.GetItems();
+
+            commands.UseProgram(textureShader.ID);
+            commands.SetInt("tex", 0);
+
+            unsigned int vertexArray = 0;
+            Texture     *texture     = NULL;
+            for (unsigned int i = first; i < last; i++) {
+                if (items[i].vertexArray != vertexArray) {
+                    vertexArray = items[i].vertexArray;
+                    commands.BindVertexArray(vertexArray);
+                }
+                if (items[i].texture != texture) {
+                    texture = items[i].texture;
+                    commands.BindTexture(0, texture);
+                }
+                bindTransforms(items[i].model);
+
+                unsigned int object = items[i].prepass;
+                if (object != DrawList::NoPrepass) {
+                    commands.Call([&prepass, object]() { prepass.BeginShading(object); });
+                }
+                commands.DrawIndexed(items[i].indexCount);
+                if (object != DrawList::NoPrepass) {
+                    commands.Call([&prepass, object]() { prepass.EndShading(object); });
+                }
+            }
+        };
+
+        for (int i = 0; i < orbitingLights; i++) {
+            float angle  = time * (0.2f + (i % 7) * 0.05f) + i * 2.4f;
+            float radius = 1.0f + (i % 16) * 0.6f;
+            frameLights[2 + i].position = glm::vec3(std::cos(angle) * radius,
+                                                    -0.3f + (i % 5) * 0.4f,
+                                                    std::sin(angle) * radius);
         }
+        commands.Call([&pointLights, frameLights]() { pointLights = frameLights; });
+
+        // The non-forward model goes first, both paths also hand their depth to
+        // the scene target so everything forward below composites against it
+        if (renderPath == DEFERRED_PATH) {
+            commands.Disable(CommandBuffer::CULL_FACE);
+            bindTransforms(nanosuitModel);
+            commands.Call([&, view, projection, viewPos]() {
+                nanosuit.Draw(deferred.BeginGeometry(view, projection, 32.0f));
+                deferred.EndGeometry();
+                deferred.Light(sceneTarget, sun, pointLights, viewPos);
+            });
+            commands.Enable(CommandBuffer::CULL_FACE);
+        } else if (renderPath == VISIBILITY_PATH) {
+            commands.Disable(CommandBuffer::CULL_FACE);
+            commands.Call([&, view, projection, viewPos]() {
+                visibilityBuffer.DrawGeometry(view, projection);
+                visibilityBuffer.Resolve(sceneTarget, viewPos);
+            });
+            commands.Enable(CommandBuffer::CULL_FACE);
+        }
+
+        if (prepassMode != DepthPrepass::OFF) {
+            bool forward = renderPath == FORWARD_PATH, cubes = !gpuCulling;
+            commands.Call([&, view, projection, forward, cubes]() {
+                prepass.BeginDepthPass(view, projection);
+
+                glBindVertexArray(floorVAO);
+                if (prepass.DrawDepth(floorPrepass, glm::mat4(1.0f))) {
+                    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                }
+
+                glBindVertexArray(cubeVAO);
+                for (int i = 0; i < 2 && cubes; i++) {
+                    if (prepass.DrawDepth(cubePrepass[i],
+                                          glm::translate(glm::mat4(1.0f), cubePositions[i]))) {
+                        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+                    }
+                }
+
+                glDisable(GL_CULL_FACE);
+                if (forward && prepass.DrawDepth(nanosuitPrepass, nanosuitModel)) {
+                    nanosuit.DrawDepth();
+                }
+                glEnable(GL_CULL_FACE);
 
-        glDisable(GL_CULL_FACE);
-
-        glBindVertexArray(windowVAO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, windowEBO);
-        glBindTexture(GL_TEXTURE_2D, window_tex.GetID());
-        textureShader.setInt("tex", 0);
-        textureShader.setMat4("projection", projection);
-        textureShader.setMat4("view", view);
-        std::map<float, glm::vec3> sorted;
-        for (unsigned int i = 0; i < num_windows; i++) {
-            float distance   = glm::length(camera.Position - windowPositions[i]);
-            sorted[distance] = windowPositions[i];
+                prepass.EndDepthPass();
+            });
         }
 
-        for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend();
-             ++it) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, it->second);
-            textureShader.setMat4("model", model);
-            glDrawElements(GL_TRIANGLES, sizeof(windowIndices), GL_UNSIGNED_INT, 0);
+        recordDraws(0, drawList.GetOpaqueCount());
+
+        if (gpuCulling) {
+            // Last frame's visible set first, then whatever it no longer hides
+            glm::mat4 viewProjection = projection * view;
+            commands.Call([&, view, projection, viewProjection]() {
+                instancedShader->use();
+                instancedShader->setInt("tex", 0);
+                instancedShader->setMat4("projection", projection);
+                instancedShader->setMat4("view", view);
+                glBindVertexArray(cubeVAO);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, marble_tex.GetID());
+                gpuCuller->Draw();
+
+                hiZ.Build(sceneTarget.GetDepth());
+                gpuCuller->CullLate(viewProjection, &hiZ);
+
+                instancedShader->use();
+                glBindVertexArray(cubeVAO);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, marble_tex.GetID());
+                gpuCuller->Draw();
+            });
         }
 
-        SDL_GL_SwapWindow(window);
+        commands.Disable(CommandBuffer::CULL_FACE);
+
+        ForwardLighting lighting = forwardLighting;
+        bool            forward = renderPath == FORWARD_PATH, queries = queryCulling;
+        TransformsBlock nanosuitTransforms = transformsFor(nanosuitModel);
+        commands.Call([&, view, projection, lighting, forward, queries, width, height,
+                       nanosuitTransforms]() {
+            // Drawn after the occluders so its proxy query sees their depth
+            occlusionQueries.BeginFrame();
+            if (lighting == OBJECT_LIGHTS) {
+                lightManager.Update();
+            } else if (lighting == CLUSTERED_LIGHTS) {
+                clustered.Update(pointLights, view, projection);
+            }
+
+            auto setupNanosuit = [&](Shader &shader) {
+                if (lighting == OBJECT_LIGHTS) {
+                    lightManager.Bind(shader, nanosuitLights);
+                } else if (lighting == CLUSTERED_LIGHTS) {
+                    clustered.Bind(shader, width, height);
+                }
+            };
+            auto drawNanosuit = [&]() {
+                uploadTransforms(nanosuitTransforms);
+                prepass.BeginShading(nanosuitPrepass);
+                if (lighting == FIXED_LIGHTS) {
+                    nanosuit.Draw(modelVariants, fixedLightsKey, setupNanosuit);
+                } else {
+                    Shader &shader = shaderManager.Get(
+                        lighting == OBJECT_LIGHTS ? lightListProgram : clusteredProgram);
+                    shader.use();
+                    setupNanosuit(shader);
+                    nanosuit.Draw(shader);
+                }
+                prepass.EndShading(nanosuitPrepass);
+            };
+            if (forward && queries) {
+                occlusionQueries.Draw(nanosuitQuery, nanosuitModel, view, projection, drawNanosuit);
+            } else if (forward) {
+                drawNanosuit();
+            }
+        });
+
+        // Transparent windows, back to front
+        recordDraws(drawList.GetOpaqueCount(), drawList.GetItems().size());
+
+        commands.Call(
+            [&sceneTarget, width, height]() { sceneTarget.BlitToDefault(width, height); });
+        commands.Viewport(0, 0, width, height);
+
+        commands.Present();
+        commands.Call([&frameSync]() { frameSync.EndFrame(); });
+
+        renderThread.Submit();
+        limiter.Wait();
     }
 
+    // Back on this thread for the cleanup below
+    renderThread.Stop();
+
+    delete gpuCuller;
+    delete instancedShader;
+
     glDeleteVertexArrays(1, &floorVAO);
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteBuffers(1, &floorVBO);
@@ -347,6 +1048,8 @@ int main(int argc, char **argv) {
     glDeleteBuffers(1, &floorEBO);
     glDeleteBuffers(1, &cubeEBO);
 
+    ResourceLoader::Stop();
+    JobSystem::Stop();
     SDL_DestroyWindow(window);
     return 0;
 }
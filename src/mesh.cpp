@@ -1,16 +1,47 @@
 #include <mesh.hpp>
 
+#include <resource_loader.hpp>
+#include <shader_variants.hpp>
+#include <upload_manager.hpp>
+#include <upload_scheduler.hpp>
+
 #include <glad/glad.h>
 
+#include <string.h>
+
 Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) {
     this->vertices = vertices;
     this->indices  = indices;
     this->textures = textures;
 
+    for (unsigned int i = 0; i < vertices.size(); i++) {
+        bounds.Expand(vertices[i].Position);
+    }
+
     setupMesh();
 }
 
 void Mesh::Draw(Shader shader) {
+    if (!buffers->VAO) {
+        return;
+    }
+    BindTextures(shader);
+
+    glBindVertexArray(buffers->VAO);
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void Mesh::DrawDepth() {
+    if (!buffers->positionVAO) {
+        return;
+    }
+    glBindVertexArray(buffers->positionVAO);
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void Mesh::BindTextures(const Shader &shader) {
     unsigned int diffuseNr  = 1;
     unsigned int specularNr = 1;
 
@@ -25,32 +56,101 @@ void Mesh::Draw(Shader shader) {
             number = std::to_string(specularNr++);
         }
 
-        shader.setFloat(("material." + name + number).c_str(), i);
+        shader.setInt(name + number, i);
         glBindTexture(GL_TEXTURE_2D, textures[i].GetID());
     }
 
     glActiveTexture(GL_TEXTURE0);
+}
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+unsigned int Mesh::GetVariantFeatures() {
+    unsigned int features = 0;
+
+    for (unsigned int i = 0; i < textures.size(); i++) {
+        if (textures[i].GetID() == 0) {
+            continue;
+        }
+        if (textures[i].GetType() == "texture_specular") {
+            features |= VARIANT_SPECULAR_MAP;
+        } else if (textures[i].GetType() == "texture_diffuse" && textures[i].HasAlpha()) {
+            features |= VARIANT_ALPHA_TEST;
+        }
+    }
+
+    return features;
 }
 
+// Vertices, indices and depth-only positions share one staging buffer and
+// reach immutable storage through GPU-side copies, queued ahead of textures.
+// With the loader thread the buffers are created and filled there instead.
 void Mesh::setupMesh() {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    GLsizeiptr vertexSize   = vertices.size() * sizeof(Vertex);
+    GLsizeiptr indexSize    = indices.size() * sizeof(unsigned int);
+    GLsizeiptr positionSize = vertices.size() * sizeof(glm::vec3);
+
+    buffers = std::make_shared<Buffers>();
+    memset(buffers.get(), 0, sizeof(Buffers));
+
+    if (ResourceLoader::IsRunning()) {
+        std::shared_ptr<Buffers> target = buffers;
+        vector<Vertex>           vertexData(vertices);
+        vector<unsigned int>     indexData(indices);
+
+        auto work = [target, vertexData, indexData, vertexSize, indexSize, positionSize]() {
+            vector<glm::vec3> positions(vertexData.size());
+            for (unsigned int i = 0; i < vertexData.size(); i++) {
+                positions[i] = vertexData[i].Position;
+            }
+
+            glGenBuffers(1, &target->VBO);
+            glGenBuffers(1, &target->EBO);
+            glGenBuffers(1, &target->positionVBO);
+            UploadManager::AllocateBuffer(target->VBO, vertexSize, &vertexData[0]);
+            UploadManager::AllocateBuffer(target->EBO, indexSize, &indexData[0]);
+            UploadManager::AllocateBuffer(target->positionVBO, positionSize, &positions[0]);
+        };
+        ResourceLoader::Queue(std::move(work), [target]() { setupVertexArrays(*target); });
+        return;
+    }
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glGenBuffers(1, &buffers->VBO);
+    glGenBuffers(1, &buffers->EBO);
+    glGenBuffers(1, &buffers->positionVBO);
+
+    UploadManager::AllocateBuffer(buffers->VBO, vertexSize);
+    UploadManager::AllocateBuffer(buffers->EBO, indexSize);
+    UploadManager::AllocateBuffer(buffers->positionVBO, positionSize);
+
+    unsigned int   staging;
+    GLintptr       offset;
+    unsigned char *data = (unsigned char *)UploadManager::Stage(
+        vertexSize + indexSize + positionSize, staging, offset);
+    if (data) {
+        memcpy(data, &vertices[0], vertexSize);
+        memcpy(data + vertexSize, &indices[0], indexSize);
+
+        glm::vec3 *positions = (glm::vec3 *)(data + vertexSize + indexSize);
+        for (unsigned int i = 0; i < vertices.size(); i++) {
+            positions[i] = vertices[i].Position;
+        }
 
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        UploadScheduler::QueueBuffer(staging, offset, buffers->VBO, vertexSize);
+        UploadScheduler::QueueBuffer(staging, offset + vertexSize, buffers->EBO, indexSize);
+        UploadScheduler::QueueBuffer(
+            staging, offset + vertexSize + indexSize, buffers->positionVBO, positionSize);
+    }
+
+    setupVertexArrays(*buffers);
+}
+
+// Vertex arrays are not shared between contexts, so always made here
+void Mesh::setupVertexArrays(Buffers &buffers) {
+    glGenVertexArrays(1, &buffers.VAO);
+    glGenVertexArrays(1, &buffers.positionVAO);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 indices.size() * sizeof(unsigned int),
-                 &indices[0],
-                 GL_STATIC_DRAW);
+    glBindVertexArray(buffers.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
@@ -65,11 +165,18 @@ void Mesh::setupMesh() {
 
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2,
-                          3,
+                          2,
                           GL_FLOAT,
                           GL_FALSE,
                           sizeof(Vertex),
                           (void *)offsetof(Vertex, TexCoords));
 
+    glBindVertexArray(buffers.positionVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.positionVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+
     glBindVertexArray(0);
 }
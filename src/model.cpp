@@ -1,5 +1,9 @@
 #include <model.hpp>
 
+#include <job_system.hpp>
+#include <resource_loader.hpp>
+
+#include <algorithm>
 #include <stb_image.h>
 #include <stdio.h>
 
@@ -11,6 +15,46 @@ void Model::Draw(Shader shader) {
     }
 }
 
+// Each mesh adds its material's features to key, so it gets the cheapest
+// variant that can draw it. setup runs whenever the program changes.
+void Model::Draw(ShaderVariants                     &variants,
+                 unsigned int                        key,
+                 const std::function<void(Shader &)> &setup) {
+    Shader *current = NULL;
+
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        Shader &shader = variants.Get(key | meshes[i].GetVariantFeatures());
+        if (&shader != current) {
+            current = &shader;
+            shader.use();
+            setup(shader);
+        }
+        meshes[i].Draw(shader);
+    }
+}
+
+void Model::DrawDepth() {
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        meshes[i].DrawDepth();
+    }
+}
+
+AABB Model::GetBounds() {
+    return bounds;
+}
+
+unsigned int Model::GetTriangleCount() {
+    unsigned int triangles = 0;
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        triangles += meshes[i].indices.size() / 3;
+    }
+    return triangles;
+}
+
+vector<Mesh> &Model::GetMeshes() {
+    return meshes;
+}
+
 void Model::loadModel(string path) {
     Assimp::Importer import;
     const aiScene   *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
@@ -23,25 +67,67 @@ void Model::loadModel(string path) {
 
     directory = path.substr(0, path.find_last_of('/'));
 
-    processNode(scene->mRootNode, scene);
+    vector<aiMesh *> sceneMeshes;
+    processNode(scene->mRootNode, scene, sceneMeshes);
+
+    // Image decoding and vertex conversion make no GL calls, so they run as
+    // jobs; the GL objects are created here once all of them are done. The
+    // loader thread decodes images itself.
+    vector<string> texturePaths;
+    for (unsigned int i = 0; i < sceneMeshes.size(); i++) {
+        aiMaterial *material = scene->mMaterials[sceneMeshes[i]->mMaterialIndex];
+        addTexturePaths(material, aiTextureType_DIFFUSE, texturePaths);
+        addTexturePaths(material, aiTextureType_SPECULAR, texturePaths);
+    }
+
+    vector<TextureImage> images(texturePaths.size());
+    JobCounter           decoded;
+    if (!ResourceLoader::IsRunning()) {
+        for (unsigned int i = 0; i < texturePaths.size(); i++) {
+            string filename = directory + '/' + texturePaths[i];
+            JobSystem::Run([&images, filename, i]() { images[i] = Texture::Decode(filename); },
+                           &decoded);
+        }
+    }
+
+    vector<vector<Vertex>>       vertices(sceneMeshes.size());
+    vector<vector<unsigned int>> indices(sceneMeshes.size());
+    JobSystem::ParallelFor(0, sceneMeshes.size(), 1, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            processMesh(sceneMeshes[i], vertices[i], indices[i]);
+        }
+    });
+    JobSystem::Wait(decoded);
+
+    for (unsigned int i = 0; i < sceneMeshes.size(); i++) {
+        aiMaterial     *material = scene->mMaterials[sceneMeshes[i]->mMaterialIndex];
+        vector<Texture> textures;
+
+        vector<Texture> diffuseMaps = loadMaterialTextures(
+            material, aiTextureType_DIFFUSE, "texture_diffuse", texturePaths, images);
+        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+
+        vector<Texture> specularMaps = loadMaterialTextures(
+            material, aiTextureType_SPECULAR, "texture_specular", texturePaths, images);
+        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+
+        meshes.push_back(Mesh(vertices[i], indices[i], textures));
+        bounds.Expand(meshes.back().bounds);
+    }
 }
 
-void Model::processNode(aiNode *node, const aiScene *scene) {
+void Model::processNode(aiNode *node, const aiScene *scene, vector<aiMesh *> &sceneMeshes) {
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, sceneMeshes);
     }
 }
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
-    vector<Vertex>       vertices;
-    vector<unsigned int> indices;
-    vector<Texture>      textures;
-
+void Model::processMesh(aiMesh *mesh, vector<Vertex> &vertices, vector<unsigned int> &indices) {
+    vertices.reserve(mesh->mNumVertices);
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
         Vertex    vertex;
         glm::vec3 vector;
@@ -73,40 +159,45 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
             indices.push_back(face.mIndices[j]);
         }
     }
+}
 
-    if (mesh->mMaterialIndex >= 0) {
-        aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-
-        vector<Texture> diffuseMaps =
-            loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-        vector<Texture> specularMaps =
-            loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+void Model::addTexturePaths(aiMaterial *mat, aiTextureType type, vector<string> &paths) {
+    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
+        aiString str;
+        mat->GetTexture(type, i, &str);
+        if (std::find(paths.begin(), paths.end(), str.C_Str()) == paths.end()) {
+            paths.push_back(str.C_Str());
+        }
     }
-
-    return Mesh(vertices, indices, textures);
 }
 
-vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName) {
+// images holds the decoded pixels of paths, entries without pixels are
+// decoded when their Texture is made
+vector<Texture> Model::loadMaterialTextures(aiMaterial           *mat,
+                                            aiTextureType         type,
+                                            string                typeName,
+                                            const vector<string> &paths,
+                                            vector<TextureImage> &images) {
     vector<Texture> textures;
 
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
         aiString str;
         mat->GetTexture(type, i, &str);
-        bool skip = false;
+        string filename = directory + '/' + str.C_Str();
+        bool   skip     = false;
 
         for (unsigned int j = 0; j < textures_loaded.size(); j++) {
-            if (std::strcmp(textures_loaded[j].GetPath().data(), str.C_Str()) == 0) {
+            if (textures_loaded[j].GetPath() == filename) {
                 textures.push_back(textures_loaded[j]);
                 skip = true;
                 break;
             }
         }
         if (!skip) {
-            string  filename = directory + '/' + str.C_Str();
-            Texture texture(filename, typeName);
+            unsigned int index = std::find(paths.begin(), paths.end(), str.C_Str()) - paths.begin();
+            Texture      texture = index < images.size() && images[index].pixels
+                                       ? Texture(filename, typeName, images[index])
+                                       : Texture(filename, typeName);
 
             textures.push_back(texture);
             textures_loaded.push_back(texture);
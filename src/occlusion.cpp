@@ -0,0 +1,293 @@
+#include <occlusion.hpp>
+
+#include <job_system.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static const float NearW = 1e-4f;
+
+OcclusionCuller::OcclusionCuller(int width, int height) {
+    // Rows are processed four pixels at a time, keep the width a multiple of 4
+    this->width  = (width + 3) & ~3;
+    this->height = height;
+    this->tilesX = (this->width + TileWidth - 1) / TileWidth;
+    this->tilesY = (this->height + TileHeight - 1) / TileHeight;
+
+    depth.assign(this->width * this->height, 1.0f);
+    viewProjection = glm::mat4(1.0f);
+    stats          = OcclusionStats();
+    tested         = 0;
+    culled         = 0;
+}
+
+void OcclusionCuller::Begin(const glm::mat4 &viewProjection) {
+    this->viewProjection = viewProjection;
+    triangles.clear();
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    stats  = OcclusionStats();
+    tested = 0;
+    culled = 0;
+}
+
+void OcclusionCuller::AddOccluder(const float        *positions,
+                                  unsigned int        vertexCount,
+                                  unsigned int        stride,
+                                  const unsigned int *indices,
+                                  unsigned int        indexCount,
+                                  const glm::mat4    &model) {
+    glm::mat4 mvp = viewProjection * model;
+
+    clipped.resize(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        const float *p = positions + i * stride;
+        clipped[i]     = mvp * glm::vec4(p[0], p[1], p[2], 1.0f);
+    }
+
+    for (unsigned int i = 0; i + 2 < indexCount; i += 3) {
+        Triangle tri;
+        bool     rejected = false;
+
+        for (int j = 0; j < 3; j++) {
+            const glm::vec4 &c = clipped[indices[i + j]];
+
+            // Triangles crossing the near plane are dropped instead of clipped.
+            // Losing an occluder only ever makes the test more conservative.
+            if (c.z < -c.w || c.w < NearW) {
+                rejected = true;
+                break;
+            }
+
+            tri.v[j] = glm::vec3((c.x / c.w * 0.5f + 0.5f) * width,
+                                 (c.y / c.w * 0.5f + 0.5f) * height,
+                                 c.z / c.w * 0.5f + 0.5f);
+        }
+        if (rejected) {
+            continue;
+        }
+
+        float area = (tri.v[1].x - tri.v[0].x) * (tri.v[2].y - tri.v[0].y) -
+                     (tri.v[1].y - tri.v[0].y) * (tri.v[2].x - tri.v[0].x);
+        if (area == 0.0f) {
+            continue;
+        }
+        if (area < 0.0f) {
+            std::swap(tri.v[1], tri.v[2]);
+        }
+
+        float minX = std::min(tri.v[0].x, std::min(tri.v[1].x, tri.v[2].x));
+        float minY = std::min(tri.v[0].y, std::min(tri.v[1].y, tri.v[2].y));
+        float maxX = std::max(tri.v[0].x, std::max(tri.v[1].x, tri.v[2].x));
+        float maxY = std::max(tri.v[0].y, std::max(tri.v[1].y, tri.v[2].y));
+
+        tri.minX = std::max(0, (int)std::floor(minX));
+        tri.minY = std::max(0, (int)std::floor(minY));
+        tri.maxX = std::min(width - 1, (int)std::ceil(maxX));
+        tri.maxY = std::min(height - 1, (int)std::ceil(maxY));
+
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY) {
+            continue;
+        }
+
+        triangles.push_back(tri);
+    }
+
+    stats.occluderTriangles = triangles.size();
+}
+
+void OcclusionCuller::Rasterize() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Tiles own disjoint pixels, so any split works; one tile per job
+    // balances uneven tiles best
+    JobSystem::ParallelFor(0, tilesX * tilesY, 1, [this](int first, int last) {
+        for (int tile = first; tile < last; tile++) {
+            rasterizeTile(tile);
+        }
+    });
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.rasterizeMs                                 = elapsed.count();
+}
+
+void OcclusionCuller::rasterizeTile(int tile) {
+    int x0 = (tile % tilesX) * TileWidth;
+    int y0 = (tile / tilesX) * TileHeight;
+    int x1 = std::min(x0 + TileWidth, width) - 1;
+    int y1 = std::min(y0 + TileHeight, height) - 1;
+
+    for (unsigned int i = 0; i < triangles.size(); i++) {
+        const Triangle &tri = triangles[i];
+        if (tri.maxX < x0 || tri.minX > x1 || tri.maxY < y0 || tri.minY > y1) {
+            continue;
+        }
+
+        rasterizeTriangle(tri,
+                          std::max(x0, tri.minX),
+                          std::max(y0, tri.minY),
+                          std::min(x1, tri.maxX),
+                          std::min(y1, tri.maxY));
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const Triangle &tri, int x0, int y0, int x1, int y1) {
+    const glm::vec3 &v0 = tri.v[0];
+    const glm::vec3 &v1 = tri.v[1];
+    const glm::vec3 &v2 = tri.v[2];
+
+    // Edge functions E(x, y) = A * x + B * y + C, positive inside the triangle.
+    // The edge opposite a vertex doubles as that vertex's barycentric weight.
+    float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = (v2.y - v1.y) * v1.x - (v2.x - v1.x) * v1.y;
+    float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = (v0.y - v2.y) * v2.x - (v0.x - v2.x) * v2.y;
+    float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = (v1.y - v0.y) * v0.x - (v1.x - v0.x) * v0.y;
+
+    float invArea = 1.0f / (a0 * v0.x + b0 * v0.y + c0);
+    float za      = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+    float zb      = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+    float zc      = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * invArea;
+
+    // Tiles start on a multiple of 4 so aligning down never leaves the tile
+    x0 &= ~3;
+
+#ifdef __SSE2__
+    __m128 zero  = _mm_setzero_ps();
+    __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 step  = _mm_set1_ps(4.0f);
+
+    for (int y = y0; y <= y1; y++) {
+        float  py  = y + 0.5f;
+        __m128 px  = _mm_add_ps(_mm_set1_ps((float)x0), lanes);
+        __m128 e0  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+        __m128 e1  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+        __m128 e2  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+        __m128 z   = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+        __m128 de0 = _mm_mul_ps(_mm_set1_ps(a0), step);
+        __m128 de1 = _mm_mul_ps(_mm_set1_ps(a1), step);
+        __m128 de2 = _mm_mul_ps(_mm_set1_ps(a2), step);
+        __m128 dz  = _mm_mul_ps(_mm_set1_ps(za), step);
+
+        float *row = &depth[y * width];
+        for (int x = x0; x <= x1; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                       _mm_cmpge_ps(e2, zero));
+
+            if (_mm_movemask_ps(inside)) {
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(current, z);
+                _mm_storeu_ps(row + x,
+                              _mm_or_ps(_mm_and_ps(inside, nearest),
+                                        _mm_andnot_ps(inside, current)));
+            }
+
+            e0 = _mm_add_ps(e0, de0);
+            e1 = _mm_add_ps(e1, de1);
+            e2 = _mm_add_ps(e2, de2);
+            z  = _mm_add_ps(z, dz);
+        }
+    }
+#else
+    for (int y = y0; y <= y1; y++) {
+        float  py  = y + 0.5f;
+        float *row = &depth[y * width];
+        for (int x = x0; x <= x1; x++) {
+            float px = x + 0.5f;
+            if (a0 * px + b0 * py + c0 < 0.0f || a1 * px + b1 * py + c1 < 0.0f ||
+                a2 * px + b2 * py + c2 < 0.0f) {
+                continue;
+            }
+            row[x] = std::min(row[x], za * px + zb * py + zc);
+        }
+    }
+#endif
+}
+
+bool OcclusionCuller::IsVisible(const AABB &bounds, const glm::mat4 &model) {
+    glm::mat4 mvp = viewProjection * model;
+
+    float minX = width, minY = height, minZ = 1.0f;
+    float maxX = 0.0f, maxY = 0.0f;
+
+    tested++;
+
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 c = mvp * glm::vec4(bounds.Corner(i), 1.0f);
+
+        // The box reaches past the near plane, there is nothing to compare against
+        if (c.z < -c.w || c.w < NearW) {
+            return true;
+        }
+
+        float x = (c.x / c.w * 0.5f + 0.5f) * width;
+        float y = (c.y / c.w * 0.5f + 0.5f) * height;
+        float z = c.z / c.w * 0.5f + 0.5f;
+
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, z);
+    }
+
+    int x0 = std::max(0, (int)std::floor(minX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int x1 = std::min(width - 1, (int)std::floor(maxX));
+    int y1 = std::min(height - 1, (int)std::floor(maxY));
+
+    // Off screen entirely
+    if (x0 > x1 || y0 > y1) {
+        culled++;
+        return false;
+    }
+
+    // Testing whole aligned groups of four may include a few pixels outside the
+    // rectangle, which errs on the side of visible.
+    x0 &= ~3;
+
+#ifdef __SSE2__
+    __m128 boxDepth = _mm_set1_ps(minZ);
+    for (int y = y0; y <= y1; y++) {
+        const float *row = &depth[y * width];
+        for (int x = x0; x <= x1; x += 4) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth))) {
+                return true;
+            }
+        }
+    }
+#else
+    for (int y = y0; y <= y1; y++) {
+        const float *row = &depth[y * width];
+        for (int x = x0; x <= x1; x++) {
+            if (row[x] >= minZ) {
+                return true;
+            }
+        }
+    }
+#endif
+
+    culled++;
+    return false;
+}
+
+int OcclusionCuller::GetWidth() const {
+    return width;
+}
+
+int OcclusionCuller::GetHeight() const {
+    return height;
+}
+
+const float *OcclusionCuller::GetDepth() const {
+    return depth.data();
+}
+
+OcclusionStats OcclusionCuller::GetStats() const {
+    OcclusionStats current  = stats;
+    current.occludeesTested = tested;
+    current.occludeesCulled = culled;
+    return current;
+}
@@ -0,0 +1,222 @@
+#include <occlusion_query.hpp>
+
+#include <gtc/matrix_transform.hpp>
+
+static const float NearW = 1e-4f;
+
+OcclusionQueries::OcclusionQueries(Mode mode)
+    : proxy("shaders/lighting/light.vert", "shaders/culling/empty.frag") {
+    this->mode  = mode;
+    this->frame = 0;
+    this->stats = OcclusionQueryStats();
+
+    float boxVertexData[] = {
+        0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+    };
+    unsigned int boxIndices[] = {
+        0, 2, 1, 1, 2, 3, // -z
+        4, 5, 6, 5, 7, 6, // +z
+        0, 4, 2, 2, 4, 6, // -x
+        1, 3, 5, 3, 7, 5, // +x
+        0, 1, 4, 1, 5, 4, // -y
+        2, 6, 3, 3, 6, 7  // +y
+    };
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(boxVertexData), boxVertexData, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(boxIndices), boxIndices, GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, (void *)0);
+
+    glBindVertexArray(0);
+}
+
+OcclusionQueries::~OcclusionQueries() {
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        for (unsigned int j = 0; j < objects[i].pending.size(); j++) {
+            glDeleteQueries(1, &objects[i].pending[j]);
+        }
+    }
+    for (unsigned int i = 0; i < retired.size(); i++) {
+        glDeleteQueries(1, &retired[i].query);
+    }
+    glDeleteQueries(freeQueries.size(), freeQueries.data());
+
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteProgram(proxy.ID);
+}
+
+unsigned int OcclusionQueries::Add(const AABB &bounds) {
+    Object object;
+    object.bounds  = bounds;
+    object.visible = true;
+
+    objects.push_back(object);
+    return objects.size() - 1;
+}
+
+void OcclusionQueries::BeginFrame() {
+    frame++;
+
+    while (!retired.empty() && frame - retired.front().frame >= Latency) {
+        freeQueries.push_back(retired.front().query);
+        retired.pop_front();
+    }
+
+    stats.queriesIssued = 0;
+    stats.drawsSkipped  = 0;
+}
+
+void OcclusionQueries::Draw(unsigned int                 object,
+                            const glm::mat4             &model,
+                            const glm::mat4             &view,
+                            const glm::mat4             &projection,
+                            const std::function<void()> &draw) {
+    Object &o = objects[object];
+
+    // With the camera inside the box the proxy's faces get clipped away and
+    // the query would report nothing even though the object is in view
+    glm::mat4 mvp = projection * view * model;
+    for (int i = 0; i < 8; i++) {
+        if ((mvp * glm::vec4(o.bounds.Corner(i), 1.0f)).w < NearW) {
+            o.visible = true;
+            draw();
+            return;
+        }
+    }
+
+    if (mode == CONDITIONAL) {
+        unsigned int query = acquire();
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+        drawProxy(o.bounds, model, view, projection);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        stats.queriesIssued++;
+
+        glBeginConditionalRender(query, GL_QUERY_WAIT);
+        draw();
+        glEndConditionalRender();
+
+        Retired r;
+        r.query = query;
+        r.frame = frame;
+        retired.push_back(r);
+        return;
+    }
+
+    // Collect every result that has arrived, the newest one wins
+    while (!o.pending.empty()) {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(o.pending.front(), GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+
+        GLuint passed;
+        glGetQueryObjectuiv(o.pending.front(), GL_QUERY_RESULT, &passed);
+        o.visible = passed != 0;
+
+        freeQueries.push_back(o.pending.front());
+        o.pending.pop_front();
+    }
+
+    if (o.visible) {
+        draw();
+    } else {
+        stats.drawsSkipped++;
+    }
+
+    if (o.pending.size() < MaxPending) {
+        unsigned int query = acquire();
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+        drawProxy(o.bounds, model, view, projection);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        stats.queriesIssued++;
+
+        o.pending.push_back(query);
+    }
+}
+
+void OcclusionQueries::SetMode(Mode mode) {
+    if (mode == this->mode) {
+        return;
+    }
+
+    // Outstanding temporal queries may still be in flight
+    for (unsigned int i = 0; i < objects.size(); i++) {
+        while (!objects[i].pending.empty()) {
+            Retired r;
+            r.query = objects[i].pending.front();
+            r.frame = frame;
+            retired.push_back(r);
+            objects[i].pending.pop_front();
+        }
+        objects[i].visible = true;
+    }
+
+    this->mode = mode;
+}
+
+OcclusionQueries::Mode OcclusionQueries::GetMode() {
+    return mode;
+}
+
+OcclusionQueryStats OcclusionQueries::GetStats() {
+    return stats;
+}
+
+unsigned int OcclusionQueries::acquire() {
+    if (freeQueries.empty()) {
+        unsigned int query;
+        glGenQueries(1, &query);
+        stats.poolSize++;
+        return query;
+    }
+
+    unsigned int query = freeQueries.back();
+    freeQueries.pop_back();
+    return query;
+}
+
+void OcclusionQueries::drawProxy(const AABB      &bounds,
+                                 const glm::mat4 &model,
+                                 const glm::mat4 &view,
+                                 const glm::mat4 &projection) {
+    glm::mat4 box = glm::translate(model, bounds.min);
+    box           = glm::scale(box, bounds.max - bounds.min);
+
+    GLboolean depthMask;
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+
+    proxy.use();
+    proxy.setMat4("model", box);
+    proxy.setMat4("view", view);
+    proxy.setMat4("projection", projection);
+
+    glBindVertexArray(vao);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(depthMask);
+    if (cullFace) {
+        glEnable(GL_CULL_FACE);
+    }
+}
@@ -0,0 +1,163 @@
+#include <program_cache.hpp>
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const unsigned int Magic = 0x50524742; // "PRGB"
+
+std::string  ProgramCache::directory = "shader_cache";
+unsigned int ProgramCache::hits      = 0;
+unsigned int ProgramCache::misses    = 0;
+
+static void fnv1a(unsigned long long &hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+}
+
+void ProgramCache::SetDirectory(const std::string &directory) {
+    ProgramCache::directory = directory;
+}
+
+std::string ProgramCache::Key(const std::vector<std::string> &sources) {
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+
+    GLenum driver[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (int i = 0; i < 3; i++) {
+        const char *value = (const char *)glGetString(driver[i]);
+        if (value != NULL) {
+            fnv1a(hash, value, std::string(value).size() + 1);
+        }
+    }
+
+    // Lengths keep ("ab", "c") and ("a", "bc") apart
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        size_t size = sources[i].size();
+        fnv1a(hash, &size, sizeof(size));
+        fnv1a(hash, sources[i].data(), size);
+    }
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", hash);
+    return key;
+}
+
+bool ProgramCache::Load(unsigned int program, const std::string &key) {
+    if (!isSupported()) {
+        return false;
+    }
+
+    FILE *file = fopen(path(key).c_str(), "rb");
+    if (file == NULL) {
+        misses++;
+        return false;
+    }
+
+    unsigned int      header[2] = {0, 0};
+    std::vector<char> binary;
+    bool              read = fread(header, sizeof(header), 1, file) == 1 && header[0] == Magic;
+
+    if (read) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file) - (long)sizeof(header);
+        fseek(file, sizeof(header), SEEK_SET);
+
+        binary.resize(size > 0 ? size : 0);
+        read = !binary.empty() && fread(binary.data(), binary.size(), 1, file) == 1;
+    }
+    fclose(file);
+
+    GLint linked = GL_FALSE;
+    if (read) {
+        glProgramBinary(program, header[1], binary.data(), binary.size());
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+
+    if (linked != GL_TRUE) {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    return true;
+}
+
+void ProgramCache::SetRetrievable(unsigned int program) {
+    if (isSupported()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+void ProgramCache::Save(unsigned int program, const std::string &key) {
+    GLint linked = GL_FALSE, size = 0;
+
+    if (!isSupported()) {
+        return;
+    }
+
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (linked != GL_TRUE || size <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(size);
+    GLenum            format = 0;
+    glGetProgramBinary(program, size, &size, &format, binary.data());
+
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+
+    // Written aside and renamed so a crash never leaves a torn entry behind
+    std::string target    = path(key);
+    std::string temporary = target + ".tmp";
+    FILE       *file      = fopen(temporary.c_str(), "wb");
+    if (file == NULL) {
+        return;
+    }
+
+    unsigned int header[2] = {Magic, format};
+    bool         written   = fwrite(header, sizeof(header), 1, file) == 1 &&
+                             fwrite(binary.data(), size, 1, file) == 1;
+    fclose(file);
+
+    if (!written) {
+        remove(temporary.c_str());
+        return;
+    }
+    remove(target.c_str());
+    rename(temporary.c_str(), target.c_str());
+}
+
+unsigned int ProgramCache::GetHits() {
+    return hits;
+}
+
+unsigned int ProgramCache::GetMisses() {
+    return misses;
+}
+
+bool ProgramCache::isSupported() {
+    if (directory.empty() || !(GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)) {
+        return false;
+    }
+
+    // Drivers may support the entry points but accept no binary formats
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+std::string ProgramCache::path(const std::string &key) {
+    return directory + "/" + key + ".bin";
+}
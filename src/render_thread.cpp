@@ -0,0 +1,260 @@
+#include <render_thread.hpp>
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static float elapsedMs(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static GLenum glState(unsigned int state) {
+    switch (state) {
+        case CommandBuffer::CULL_FACE:
+            return GL_CULL_FACE;
+        case CommandBuffer::DEPTH_TEST:
+            return GL_DEPTH_TEST;
+        default:
+            return GL_BLEND;
+    }
+}
+
+RenderThread::RenderThread(SDL_Window *window, SDL_GLContext context, RingBuffer &drawData)
+    : drawData(drawData) {
+    this->window    = window;
+    this->context   = context;
+    this->recording = 0;
+    this->pending   = NULL;
+    this->replaying = false;
+    this->stopping  = false;
+    this->program   = 0;
+    this->stats     = RenderThreadStats();
+    this->started   = false;
+    this->threaded  = false;
+
+    SDL_GL_MakeCurrent(window, NULL);
+    thread = std::thread(&RenderThread::run, this);
+
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this]() { return started; });
+    guard.unlock();
+
+    if (!threaded) {
+        thread.join();
+        if (SDL_GL_MakeCurrent(window, context) != 0) {
+            printf("Failed to make the GL context current again: %s\n", SDL_GetError());
+        }
+        printf("Render thread unavailable, rendering on the calling thread\n");
+    }
+}
+
+RenderThread::~RenderThread() {
+    Stop();
+}
+
+CommandBuffer &RenderThread::GetCommands() {
+    return buffers[recording];
+}
+
+void RenderThread::Submit() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (!threaded) {
+        replay(buffers[recording]);
+
+        std::lock_guard<std::mutex> guard(lock);
+        stats.frames++;
+        stats.commands = buffers[recording].GetCommandCount();
+        stats.bytes    = buffers[recording].GetSize();
+        stats.replayMs += elapsedMs(start);
+        buffers[recording].Reset();
+        return;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this]() { return (!pending && !replaying) || stopping; });
+    if (stopping) {
+        return;
+    }
+
+    pending = &buffers[recording];
+    recording ^= 1;
+    stats.submitWaitMs += elapsedMs(start);
+    guard.unlock();
+    changed.notify_all();
+
+    // Frame N-1's buffer is free again, replaying it ended before the wait above
+    buffers[recording].Reset();
+}
+
+void RenderThread::Stop() {
+    if (!threaded) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+
+    SDL_GL_MakeCurrent(window, context);
+}
+
+RenderThreadStats RenderThread::GetStats() {
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void RenderThread::ResetStats() {
+    std::lock_guard<std::mutex> guard(lock);
+    stats = RenderThreadStats();
+}
+
+void RenderThread::run() {
+    bool current = SDL_GL_MakeCurrent(window, context) == 0;
+    if (!current) {
+        printf("Failed to make the GL context current on the render thread: %s\n",
+               SDL_GetError());
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        started  = true;
+        threaded = current;
+    }
+    changed.notify_all();
+    if (!current) {
+        return;
+    }
+
+    while (true) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [this]() { return pending || stopping; });
+        if (stopping) {
+            break;
+        }
+
+        const CommandBuffer *commands = pending;
+        pending                       = NULL;
+        replaying                     = true;
+        stats.idleMs += elapsedMs(start);
+        guard.unlock();
+
+        start = std::chrono::steady_clock::now();
+        replay(*commands);
+        float replayMs = elapsedMs(start);
+
+        guard.lock();
+        replaying = false;
+        stats.frames++;
+        stats.commands = commands->GetCommandCount();
+        stats.bytes    = commands->GetSize();
+        stats.replayMs += replayMs;
+        guard.unlock();
+        changed.notify_all();
+    }
+
+    SDL_GL_MakeCurrent(window, NULL);
+}
+
+void RenderThread::replay(const CommandBuffer &commands) {
+    size_t                offset = 0;
+    CommandBuffer::Header header;
+    const unsigned char  *payload;
+
+    while (commands.Next(offset, header, payload)) {
+        switch (header.type) {
+            case CommandBuffer::CLEAR: {
+                CommandBuffer::ClearCommand command;
+                memcpy(&command, payload, sizeof(command));
+                glClearColor(
+                    command.color[0], command.color[1], command.color[2], command.color[3]);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                break;
+            }
+            case CommandBuffer::VIEWPORT: {
+                CommandBuffer::ViewportCommand command;
+                memcpy(&command, payload, sizeof(command));
+                glViewport(command.x, command.y, command.width, command.height);
+                break;
+            }
+            case CommandBuffer::ENABLE:
+            case CommandBuffer::DISABLE: {
+                CommandBuffer::HandleCommand command;
+                memcpy(&command, payload, sizeof(command));
+                if (header.type == CommandBuffer::ENABLE) {
+                    glEnable(glState(command.handle));
+                } else {
+                    glDisable(glState(command.handle));
+                }
+                break;
+            }
+            case CommandBuffer::USE_PROGRAM: {
+                CommandBuffer::HandleCommand command;
+                memcpy(&command, payload, sizeof(command));
+                program = command.handle;
+                glUseProgram(program);
+                break;
+            }
+            case CommandBuffer::SET_INT: {
+                CommandBuffer::IntCommand command;
+                memcpy(&command, payload, sizeof(command));
+                const char *name = (const char *)(payload + sizeof(command));
+                glUniform1i(glGetUniformLocation(program, name), command.value);
+                break;
+            }
+            case CommandBuffer::BIND_TEXTURE: {
+                CommandBuffer::TextureCommand command;
+                memcpy(&command, payload, sizeof(command));
+                glActiveTexture(GL_TEXTURE0 + command.unit);
+                glBindTexture(GL_TEXTURE_2D, command.texture->GetID());
+                break;
+            }
+            case CommandBuffer::BIND_VERTEX_ARRAY: {
+                CommandBuffer::HandleCommand command;
+                memcpy(&command, payload, sizeof(command));
+                glBindVertexArray(command.handle);
+                break;
+            }
+            case CommandBuffer::UNIFORM_BLOCK: {
+                CommandBuffer::UniformBlockCommand command;
+                memcpy(&command, payload, sizeof(command));
+
+                GLintptr blockOffset;
+                void    *slice = drawData.Allocate(command.size, blockOffset);
+                if (slice) {
+                    memcpy(slice, payload + sizeof(command), command.size);
+                    drawData.BindRange(command.binding, blockOffset, command.size);
+                }
+                break;
+            }
+            case CommandBuffer::DRAW_INDEXED: {
+                CommandBuffer::DrawCommand command;
+                memcpy(&command, payload, sizeof(command));
+                glDrawElements(GL_TRIANGLES,
+                               command.count,
+                               GL_UNSIGNED_INT,
+                               (void *)(command.firstIndex * sizeof(unsigned int)));
+                break;
+            }
+            case CommandBuffer::PRESENT: {
+                SDL_GL_SwapWindow(window);
+                break;
+            }
+            case CommandBuffer::CALL: {
+                commands.RunCall(payload);
+                break;
+            }
+        }
+    }
+}
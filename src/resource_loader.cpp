@@ -0,0 +1,175 @@
+#include <resource_loader.hpp>
+
+#include <stdio.h>
+
+SDL_Window                       *ResourceLoader::window  = NULL;
+SDL_GLContext                     ResourceLoader::context = NULL;
+SDL_sem                          *ResourceLoader::wake    = NULL;
+std::thread                       ResourceLoader::thread;
+std::atomic<bool>                 ResourceLoader::running(false);
+SpscQueue<ResourceLoader::Job *>  ResourceLoader::requests;
+SpscQueue<ResourceLoader::Job *>  ResourceLoader::results;
+std::deque<ResourceLoader::Job *> ResourceLoader::fenced;
+unsigned int                      ResourceLoader::queued    = 0;
+unsigned int                      ResourceLoader::completed = 0;
+
+bool ResourceLoader::Start(SDL_Window *window) {
+    if (thread.joinable()) {
+        return running;
+    }
+
+    // Creating a context makes it current, the main one is restored after.
+    // It gets the version and profile the main context was created with.
+    SDL_GLContext mainContext = SDL_GL_GetCurrentContext();
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    context = SDL_GL_CreateContext(window);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+    SDL_GL_MakeCurrent(window, mainContext);
+
+    if (context == NULL) {
+        printf("Failed to create the loader context: %s\n", SDL_GetError());
+        return false;
+    }
+
+    SDL_sem *ready = SDL_CreateSemaphore(0);
+    wake           = SDL_CreateSemaphore(0);
+    if (wake == NULL || ready == NULL) {
+        printf("Failed to create the loader semaphores: %s\n", SDL_GetError());
+        if (wake) {
+            SDL_DestroySemaphore(wake);
+        }
+        if (ready) {
+            SDL_DestroySemaphore(ready);
+        }
+        SDL_GL_DeleteContext(context);
+        wake    = NULL;
+        context = NULL;
+        return false;
+    }
+
+    // Nothing is queued until the thread reports whether its context could
+    // be made current, so a failure leaves callers on the main thread path
+    ResourceLoader::window = window;
+    running                = true;
+    thread                 = std::thread(run, ready);
+    SDL_SemWait(ready);
+    SDL_DestroySemaphore(ready);
+
+    if (!running) {
+        thread.join();
+        SDL_DestroySemaphore(wake);
+        SDL_GL_DeleteContext(context);
+        wake    = NULL;
+        context = NULL;
+        return false;
+    }
+    return true;
+}
+
+void ResourceLoader::Stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+
+    // Queued work is dropped, the thread finishes the job it is on
+    running = false;
+    SDL_SemPost(wake);
+    thread.join();
+
+    Job *job;
+    while (requests.Pop(job)) {
+        delete job;
+    }
+    while (results.Pop(job)) {
+        fenced.push_back(job);
+    }
+    for (unsigned int i = 0; i < fenced.size(); i++) {
+        glDeleteSync(fenced[i]->fence);
+        delete fenced[i];
+    }
+    fenced.clear();
+
+    SDL_DestroySemaphore(wake);
+    SDL_GL_DeleteContext(context);
+    wake    = NULL;
+    context = NULL;
+}
+
+bool ResourceLoader::IsRunning() {
+    return running;
+}
+
+void ResourceLoader::Queue(std::function<void()> work, std::function<void()> onReady) {
+    Job *job     = new Job();
+    job->work    = std::move(work);
+    job->onReady = std::move(onReady);
+    job->fence   = (GLsync)0;
+
+    requests.Push(job);
+    queued++;
+    SDL_SemPost(wake);
+}
+
+void ResourceLoader::Poll() {
+    if (!running) {
+        return;
+    }
+
+    Job *job;
+    while (results.Pop(job)) {
+        fenced.push_back(job);
+    }
+
+    // One context runs the jobs, so their fences signal in order
+    while (!fenced.empty()) {
+        job           = fenced.front();
+        GLenum status = glClientWaitSync(job->fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+
+        fenced.pop_front();
+        glDeleteSync(job->fence);
+        if (status == GL_WAIT_FAILED) {
+            printf("Loader fence wait failed, dropping the job's result\n");
+        } else if (job->onReady) {
+            job->onReady();
+        }
+        delete job;
+        completed++;
+    }
+}
+
+unsigned int ResourceLoader::GetPendingCount() {
+    return queued - completed;
+}
+
+unsigned int ResourceLoader::GetCompletedCount() {
+    return completed;
+}
+
+void ResourceLoader::run(SDL_sem *ready) {
+    if (SDL_GL_MakeCurrent(window, context) != 0) {
+        printf("Failed to make the loader context current: %s\n", SDL_GetError());
+        running = false;
+        SDL_SemPost(ready);
+        return;
+    }
+    SDL_SemPost(ready);
+
+    while (running) {
+        SDL_SemWait(wake);
+
+        Job *job;
+        while (running && requests.Pop(job)) {
+            job->work();
+
+            // Flushed so the main context sees the fence signal
+            job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            results.Push(job);
+        }
+    }
+
+    SDL_GL_MakeCurrent(window, NULL);
+}
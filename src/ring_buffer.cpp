@@ -0,0 +1,105 @@
+#include <ring_buffer.hpp>
+
+#include <stdio.h>
+
+RingBuffer::RingBuffer(GLenum target, GLsizeiptr frameSize, FrameSync &sync) : sync(sync) {
+    unsigned int frames = sync.GetFramesInFlight();
+
+    this->target     = target;
+    this->frameSize  = frameSize;
+    this->frame      = 0;
+    this->head       = 0;
+    this->uploaded   = 0;
+    this->overflowed = false;
+    this->mapped     = NULL;
+    this->persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+
+    GLint align = 16;
+    if (target == GL_UNIFORM_BUFFER) {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    } else if (target == GL_SHADER_STORAGE_BUFFER) {
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+    }
+    this->alignment = align;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, frameSize * frames, NULL, flags);
+        mapped = (unsigned char *)glMapBufferRange(target, 0, frameSize * frames, flags);
+    }
+
+    if (!mapped) {
+        if (persistent) {
+            printf("Failed to map ring buffer persistently, falling back to orphaning\n");
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+            persistent = false;
+        }
+        glBufferData(target, frameSize, NULL, GL_STREAM_DRAW);
+        shadow.resize(frameSize);
+        mapped = &shadow[0];
+    }
+
+    glBindBuffer(target, 0);
+}
+
+RingBuffer::~RingBuffer() {
+    if (persistent) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void RingBuffer::BeginFrame() {
+    head     = 0;
+    uploaded = 0;
+
+    if (!persistent) {
+        // Orphan, the driver hands out fresh storage if the old is in use
+        glBindBuffer(target, buffer);
+        glBufferData(target, frameSize, NULL, GL_STREAM_DRAW);
+        glBindBuffer(target, 0);
+        return;
+    }
+
+    frame = sync.GetSlot();
+}
+
+void *RingBuffer::Allocate(GLsizeiptr size, GLintptr &offset) {
+    GLintptr start = (head + alignment - 1) / alignment * alignment;
+    if (start + size > frameSize) {
+        if (!overflowed) {
+            printf("Ring buffer region of %ld bytes is full\n", (long)frameSize);
+            overflowed = true;
+        }
+        return NULL;
+    }
+    head = start + size;
+
+    offset = persistent ? frame * frameSize + start : start;
+    return mapped + offset;
+}
+
+void RingBuffer::BindRange(unsigned int index, GLintptr offset, GLsizeiptr size) {
+    if (!persistent && offset + size > uploaded) {
+        glBindBuffer(target, buffer);
+        glBufferSubData(target, uploaded, head - uploaded, &shadow[uploaded]);
+        uploaded = head;
+    }
+
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+unsigned int RingBuffer::GetID() {
+    return buffer;
+}
+
+bool RingBuffer::IsPersistent() {
+    return persistent;
+}
@@ -0,0 +1,350 @@
+#include <shader_manager.hpp>
+
+#include <program_cache.hpp>
+#include <shader_source.hpp>
+
+#include <stdio.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderManager::ShaderManager(const char *fallbackVertexPath, const char *fallbackFragmentPath)
+    : fallback(fallbackVertexPath, fallbackFragmentPath) {
+    this->pending  = 0;
+    this->reloads  = 0;
+    this->watchFd  = -1;
+    this->parallel = GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+
+    // Let the driver pick how many compiler threads to use
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    } else if (GLAD_GL_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+}
+
+ShaderManager::~ShaderManager() {
+    for (unsigned int i = 0; i < programs.size(); i++) {
+        cancel(i);
+        glDeleteProgram(shaders[i].ID);
+    }
+    glDeleteProgram(fallback.ID);
+
+#ifdef __linux__
+    if (watchFd >= 0) {
+        close(watchFd);
+    }
+#endif
+}
+
+unsigned int ShaderManager::Submit(const char                          *vertexPath,
+                                   const char                          *fragmentPath,
+                                   const std::string                   &preamble,
+                                   const std::function<void(Shader &)> &onReady) {
+    Program program;
+    program.state        = FAILED;
+    program.live         = false;
+    program.building     = 0;
+    program.vertex       = 0;
+    program.fragment     = 0;
+    program.vertexPath   = vertexPath;
+    program.fragmentPath = fragmentPath;
+    program.preamble     = preamble;
+    program.onReady      = onReady;
+
+    programs.push_back(program);
+    shaders.push_back(Shader());
+
+    unsigned int index = programs.size() - 1;
+    build(index);
+
+    return index;
+}
+
+void ShaderManager::Poll() {
+    std::set<std::string> changed;
+    readChanges(changed);
+
+    // Rebuild everything that read a changed file, includes too, restarting
+    // builds that were still in flight with the old source
+    if (!changed.empty()) {
+        for (std::set<std::string>::iterator it = changed.begin(); it != changed.end(); ++it) {
+            ShaderSource::Invalidate(*it);
+        }
+        for (unsigned int i = 0; i < programs.size(); i++) {
+            for (unsigned int f = 0; f < programs[i].files.size(); f++) {
+                if (changed.count(programs[i].files[f])) {
+                    cancel(i);
+                    build(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    unsigned int blocked    = 0;
+    bool         wasPending = pending > 0;
+
+    for (unsigned int i = 0; i < programs.size() && pending > 0; i++) {
+        Program &program = programs[i];
+
+        if (program.state == COMPILING) {
+            if (!isComplete(program.vertex, false) || !isComplete(program.fragment, false)) {
+                continue;
+            }
+            if (!parallel && blocked++ >= MaxBlockingPerPoll) {
+                return;
+            }
+
+            bool compiled = Shader::checkCompile(program.vertex, "VERTEX");
+            compiled      = Shader::checkCompile(program.fragment, "FRAGMENT") && compiled;
+            if (!compiled) {
+                finish(i, false);
+                continue;
+            }
+
+            glAttachShader(program.building, program.vertex);
+            glAttachShader(program.building, program.fragment);
+            ProgramCache::SetRetrievable(program.building);
+            glLinkProgram(program.building);
+            program.state = LINKING;
+            continue;
+        }
+
+        if (program.state == LINKING && isComplete(program.building, true)) {
+            if (!parallel && blocked++ >= MaxBlockingPerPoll) {
+                return;
+            }
+            finish(i, Shader::checkLink(program.building));
+        }
+    }
+
+    // Stages are only shared between programs built together, drop the
+    // rest once everything has linked
+    if (wasPending && pending == 0) {
+        ShaderSource::Trim();
+    }
+}
+
+bool ShaderManager::WatchForChanges() {
+#ifdef __linux__
+    if (watchFd >= 0) {
+        return true;
+    }
+
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd < 0) {
+        printf("Failed to start watching shader files\n");
+        return false;
+    }
+
+    for (unsigned int i = 0; i < programs.size(); i++) {
+        for (unsigned int f = 0; f < programs[i].files.size(); f++) {
+            watch(programs[i].files[f]);
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShaderManager::IsReady(unsigned int program) {
+    return programs[program].live;
+}
+
+Shader &ShaderManager::Get(unsigned int program) {
+    return programs[program].live ? shaders[program] : fallback;
+}
+
+Shader &ShaderManager::GetFallback() {
+    return fallback;
+}
+
+unsigned int ShaderManager::GetPendingCount() {
+    return pending;
+}
+
+unsigned int ShaderManager::GetReloadCount() {
+    return reloads;
+}
+
+bool ShaderManager::IsParallel() {
+    return parallel;
+}
+
+void ShaderManager::build(unsigned int index) {
+    Program &program = programs[index];
+
+    std::vector<std::string> fragmentFiles;
+
+    std::string vertexCode = Shader::injectPreamble(
+        ShaderSource::Load(program.vertexPath, &program.files), program.preamble);
+    std::string fragmentCode = Shader::injectPreamble(
+        ShaderSource::Load(program.fragmentPath, &fragmentFiles), program.preamble);
+    program.files.insert(program.files.end(), fragmentFiles.begin(), fragmentFiles.end());
+
+    // A rebuild may have picked up new includes
+    if (watchFd >= 0) {
+        for (unsigned int i = 0; i < program.files.size(); i++) {
+            watch(program.files[i]);
+        }
+    }
+
+    program.building = glCreateProgram();
+    program.vertex   = 0;
+    program.fragment = 0;
+    program.cacheKey = ProgramCache::Key({vertexCode, fragmentCode});
+    program.cached   = ProgramCache::Load(program.building, program.cacheKey);
+
+    if (program.cached) {
+        program.state = LINKING;
+    } else {
+        program.state    = COMPILING;
+        program.vertex   = ShaderSource::AcquireStage(GL_VERTEX_SHADER, vertexCode);
+        program.fragment = ShaderSource::AcquireStage(GL_FRAGMENT_SHADER, fragmentCode);
+    }
+
+    pending++;
+}
+
+// Drops a build in flight, the live program is untouched
+void ShaderManager::cancel(unsigned int index) {
+    Program &program = programs[index];
+
+    if (program.state != COMPILING && program.state != LINKING) {
+        return;
+    }
+
+    if (program.vertex != 0) {
+        ShaderSource::ReleaseStage(program.vertex);
+        ShaderSource::ReleaseStage(program.fragment);
+        program.vertex   = 0;
+        program.fragment = 0;
+    }
+    glDeleteProgram(program.building);
+
+    program.building = 0;
+    program.state    = program.live ? READY : FAILED;
+    pending--;
+}
+
+// Directories are watched rather than files, editors often save by
+// writing a new file and renaming it over the old one
+void ShaderManager::watch(const std::string &path) {
+#ifdef __linux__
+    std::string::size_type slash     = path.find_last_of('/');
+    std::string            directory = slash == std::string::npos ? "." : path.substr(0, slash);
+
+    if (directoryWatches.count(directory)) {
+        return;
+    }
+
+    int wd = inotify_add_watch(watchFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        printf("Failed to watch shader directory: %s\n", directory.c_str());
+        return;
+    }
+
+    directoryWatches[directory] = wd;
+    watchedDirectories[wd]      = directory;
+#endif
+}
+
+void ShaderManager::readChanges(std::set<std::string> &changed) {
+#ifdef __linux__
+    if (watchFd < 0) {
+        return;
+    }
+
+    alignas(struct inotify_event) char buffer[4096];
+
+    for (;;) {
+        ssize_t length = read(watchFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+
+        for (char *ptr = buffer; ptr < buffer + length;) {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            std::map<int, std::string>::iterator it = watchedDirectories.find(event->wd);
+            if (event->len == 0 || it == watchedDirectories.end()) {
+                continue;
+            }
+
+            std::string path = it->second == "." ? event->name : it->second + "/" + event->name;
+            changed.insert(path);
+        }
+    }
+#endif
+}
+
+bool ShaderManager::isComplete(unsigned int object, bool isProgram) {
+    // Without the extension every status query may block, treat it as done
+    if (!parallel) {
+        return true;
+    }
+
+    GLint complete = GL_FALSE;
+    if (isProgram) {
+        glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+    } else {
+        glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+    }
+    return complete == GL_TRUE;
+}
+
+void ShaderManager::finish(unsigned int index, bool linked) {
+    Program &program = programs[index];
+    Shader  &shader  = shaders[index];
+
+    if (program.vertex != 0) {
+        ShaderSource::ReleaseStage(program.vertex);
+        ShaderSource::ReleaseStage(program.fragment);
+        program.vertex   = 0;
+        program.fragment = 0;
+    }
+
+    pending--;
+
+    // A broken rebuild keeps the previous program, a broken first build
+    // keeps drawing with the fallback
+    if (!linked) {
+        if (program.live) {
+            printf("Keeping previous program for %s, %s\n",
+                   program.vertexPath.c_str(),
+                   program.fragmentPath.c_str());
+        }
+        glDeleteProgram(program.building);
+        program.building = 0;
+        program.state    = program.live ? READY : FAILED;
+        return;
+    }
+
+    if (!program.cached) {
+        ProgramCache::Save(program.building, program.cacheKey);
+    }
+
+    // Swapped between frames, so no draw sees a mix of old and new programs
+    if (program.live) {
+        glDeleteProgram(shader.ID);
+        reloads++;
+        printf("Reloaded %s, %s\n", program.vertexPath.c_str(), program.fragmentPath.c_str());
+    }
+    shader.ID        = program.building;
+    program.building = 0;
+    BindUniformBlocks(shader.ID);
+    program.live     = true;
+    program.state    = READY;
+
+    if (program.onReady) {
+        shader.use();
+        program.onReady(shader);
+    }
+}
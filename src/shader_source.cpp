@@ -0,0 +1,237 @@
+#include <shader_source.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::map<std::string, std::string>            ShaderSource::fileCache;
+std::map<std::string, ShaderSource::Expanded> ShaderSource::expandedCache;
+std::map<std::string, ShaderSource::Stage>    ShaderSource::stages;
+std::map<unsigned int, std::string>           ShaderSource::stageKeys;
+unsigned int                                  ShaderSource::fileReads     = 0;
+unsigned int                                  ShaderSource::stageCompiles = 0;
+unsigned int                                  ShaderSource::stageReuses   = 0;
+
+std::string ShaderSource::Load(const std::string &path, std::vector<std::string> *files) {
+    std::string key = normalize(path);
+
+    std::map<std::string, Expanded>::iterator it = expandedCache.find(key);
+    if (it == expandedCache.end()) {
+        Expanded expanded;
+        if (!expand(key, expanded.files, expanded.code)) {
+            if (files) {
+                *files = expanded.files;
+            }
+            return "";
+        }
+        it = expandedCache.insert(std::make_pair(key, expanded)).first;
+    }
+
+    if (files) {
+        *files = it->second.files;
+    }
+    return it->second.code;
+}
+
+void ShaderSource::Invalidate(const std::string &path) {
+    std::string key = normalize(path);
+
+    fileCache.erase(key);
+
+    std::map<std::string, Expanded>::iterator it = expandedCache.begin();
+    while (it != expandedCache.end()) {
+        const std::vector<std::string> &files = it->second.files;
+        bool                            stale = false;
+        for (unsigned int i = 0; i < files.size() && !stale; i++) {
+            stale = files[i] == key;
+        }
+
+        if (stale) {
+            it = expandedCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+unsigned int ShaderSource::AcquireStage(GLenum type, const std::string &code) {
+    std::string key = std::to_string(type) + "\n" + code;
+
+    std::map<std::string, Stage>::iterator it = stages.find(key);
+    if (it != stages.end()) {
+        it->second.refs++;
+        stageReuses++;
+        return it->second.id;
+    }
+
+    const char *source = code.c_str();
+
+    Stage stage;
+    stage.id   = glCreateShader(type);
+    stage.refs = 1;
+    glShaderSource(stage.id, 1, &source, NULL);
+    glCompileShader(stage.id);
+
+    stages[key]         = stage;
+    stageKeys[stage.id] = key;
+    stageCompiles++;
+
+    return stage.id;
+}
+
+void ShaderSource::ReleaseStage(unsigned int stage) {
+    std::map<unsigned int, std::string>::iterator it = stageKeys.find(stage);
+    if (it != stageKeys.end() && stages[it->second].refs > 0) {
+        stages[it->second].refs--;
+    }
+}
+
+void ShaderSource::Trim() {
+    std::map<std::string, Stage>::iterator it = stages.begin();
+    while (it != stages.end()) {
+        if (it->second.refs == 0) {
+            glDeleteShader(it->second.id);
+            stageKeys.erase(it->second.id);
+            it = stages.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+unsigned int ShaderSource::GetFileReads() {
+    return fileReads;
+}
+
+unsigned int ShaderSource::GetStageCompiles() {
+    return stageCompiles;
+}
+
+unsigned int ShaderSource::GetStageReuses() {
+    return stageReuses;
+}
+
+const std::string &ShaderSource::read(const std::string &path) {
+    static const std::string empty;
+
+    std::map<std::string, std::string>::iterator it = fileCache.find(path);
+    if (it != fileCache.end()) {
+        return it->second;
+    }
+
+    std::ifstream file;
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    try {
+        file.open(path.c_str());
+        std::stringstream stream;
+        stream << file.rdbuf();
+        file.close();
+
+        fileReads++;
+        return fileCache[path] = stream.str();
+    } catch (std::ifstream::failure &e) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+    }
+
+    return empty;
+}
+
+bool ShaderSource::expand(const std::string        &path,
+                          std::vector<std::string> &files,
+                          std::string              &code) {
+    unsigned int index = files.size();
+    files.push_back(path);
+
+    const std::string &text = read(path);
+    if (text.empty()) {
+        return false;
+    }
+
+    std::string::size_type slash     = path.find_last_of('/');
+    std::string            directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+    std::istringstream lines(text);
+    std::string        line;
+    unsigned int       lineNumber = 0;
+
+    while (std::getline(lines, line)) {
+        lineNumber++;
+
+        std::string::size_type start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            start = line.size();
+        }
+
+        // Only the top-level file may declare a version
+        if (index > 0 && line.compare(start, 8, "#version") == 0) {
+            code += "\n";
+            continue;
+        }
+        if (line.compare(start, 8, "#include") != 0) {
+            code += line + "\n";
+            continue;
+        }
+
+        std::string::size_type open  = line.find('"', start);
+        std::string::size_type close = open == std::string::npos ? open : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            std::cout << "ERROR::SHADER::BAD_INCLUDE: " << path << ":" << lineNumber << std::endl;
+            return false;
+        }
+
+        std::string include = normalize(directory + line.substr(open + 1, close - open - 1));
+
+        // Already inlined further up, nothing to add
+        bool seen = false;
+        for (unsigned int i = 0; i < files.size() && !seen; i++) {
+            seen = files[i] == include;
+        }
+        if (seen) {
+            code += "\n";
+            continue;
+        }
+
+        code += "#line 1 " + std::to_string(files.size()) + "\n";
+        if (!expand(include, files, code)) {
+            std::cout << "ERROR::SHADER::INCLUDE_FAILED: " << path << ":" << lineNumber
+                      << std::endl;
+            return false;
+        }
+        code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+    }
+
+    return true;
+}
+
+// Folds "." and "dir/.." so each file has one cache and watch key
+std::string ShaderSource::normalize(const std::string &path) {
+    std::vector<std::string> parts;
+    std::string::size_type   start = 0;
+
+    while (start <= path.size()) {
+        std::string::size_type end = path.find('/', start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+
+        std::string part = path.substr(start, end - start);
+        if (part == "..") {
+            if (!parts.empty() && parts.back() != "..") {
+                parts.pop_back();
+            } else {
+                parts.push_back(part);
+            }
+        } else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+
+        start = end + 1;
+    }
+
+    std::string result = path.compare(0, 1, "/") == 0 ? "/" : "";
+    for (unsigned int i = 0; i < parts.size(); i++) {
+        result += (i > 0 ? "/" : "") + parts[i];
+    }
+    return result;
+}
@@ -0,0 +1,110 @@
+#include <shader_variants.hpp>
+
+#include <algorithm>
+
+// std::min() takes it by reference, so it needs storage
+const unsigned int ShaderVariants::MaxPointLights;
+
+ShaderVariants::ShaderVariants(const char *vertexPath, const char *fragmentPath)
+    : ShaderVariants(vertexPath, fragmentPath, NULL) {
+}
+
+ShaderVariants::ShaderVariants(const char    *vertexPath,
+                               const char    *fragmentPath,
+                               ShaderManager *manager) {
+    this->vertexPath   = vertexPath;
+    this->fragmentPath = fragmentPath;
+    this->manager      = manager;
+}
+
+ShaderVariants::~ShaderVariants() {
+    for (std::map<unsigned int, Shader *>::iterator it = programs.begin(); it != programs.end();
+         ++it) {
+        glDeleteProgram(it->second->ID);
+        delete it->second;
+    }
+}
+
+unsigned int ShaderVariants::Key(unsigned int features, unsigned int pointLights) {
+    return (features & FeatureMask) | (std::min(pointLights, MaxPointLights) << PointLightBits);
+}
+
+std::string ShaderVariants::Preamble(unsigned int key) {
+    std::string preamble = "#define SHADER_VARIANTS\n";
+
+    if (key & VARIANT_SPECULAR_MAP) {
+        preamble += "#define HAS_SPECULAR_MAP\n";
+    }
+    if (key & VARIANT_ALPHA_TEST) {
+        preamble += "#define ALPHA_TEST\n";
+    }
+    if (key & VARIANT_INSTANCED) {
+        preamble += "#define INSTANCED\n";
+    }
+    if (key & VARIANT_POSITION_UV) {
+        preamble += "#define VERTEX_POSITION_UV\n";
+    }
+    preamble += "#define POINT_LIGHT_COUNT " + std::to_string(key >> PointLightBits) + "\n";
+
+    return preamble;
+}
+
+void ShaderVariants::SetInitializer(const std::function<void(Shader &)> &initializer) {
+    this->initializer = initializer;
+}
+
+void ShaderVariants::Prewarm(const std::vector<unsigned int> &keys) {
+    if (!manager) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < keys.size(); i++) {
+        if (submitted.find(keys[i]) == submitted.end()) {
+            submitted[keys[i]] = submit(keys[i]);
+        }
+    }
+}
+
+Shader &ShaderVariants::Get(unsigned int key) {
+    // Programs owned by the manager, ready or not
+    if (manager) {
+        std::map<unsigned int, unsigned int>::iterator it = submitted.find(key);
+        if (it == submitted.end()) {
+            it = submitted.insert(std::make_pair(key, submit(key))).first;
+        }
+        return manager->Get(it->second);
+    }
+
+    std::map<unsigned int, Shader *>::iterator it = programs.find(key);
+    if (it != programs.end()) {
+        return *it->second;
+    }
+
+    Shader *shader = new Shader(vertexPath.c_str(), fragmentPath.c_str(), Preamble(key));
+    programs[key]  = shader;
+
+    if (initializer) {
+        shader->use();
+        initializer(*shader);
+    }
+
+    return *shader;
+}
+
+unsigned int ShaderVariants::GetCompiledCount() {
+    if (!manager) {
+        return programs.size();
+    }
+
+    unsigned int ready = 0;
+    for (std::map<unsigned int, unsigned int>::iterator it = submitted.begin();
+         it != submitted.end();
+         ++it) {
+        ready += manager->IsReady(it->second) ? 1 : 0;
+    }
+    return ready;
+}
+
+unsigned int ShaderVariants::submit(unsigned int key) {
+    return manager->Submit(vertexPath.c_str(), fragmentPath.c_str(), Preamble(key), initializer);
+}
@@ -1,68 +1,190 @@
 #include <texture.hpp>
 
 #include <glad/glad.h>
+#include <resource_loader.hpp>
 #include <stb_image.h>
+#include <upload_manager.hpp>
+#include <upload_scheduler.hpp>
 
 #include <stdio.h>
+#include <string.h>
 
-Texture::Texture(std::string path, std::string type) {
-    int          height, width, nChannels;
-    unsigned int texture, format;
-
-    unsigned char *imageData = stbi_load(path.c_str(), &width, &height, &nChannels, 0);
-
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    if (!imageData) {
-        printf("Failed to load image data from path: %s\n", path.c_str());
-        return;
-    }
+static void deleteTexture(unsigned int *texture) {
+    glDeleteTextures(1, texture);
+    delete texture;
+}
 
-    switch (nChannels) {
+static bool pixelFormat(int channels, GLenum &format, GLenum &internalFormat) {
+    switch (channels) {
         case 1: {
-            format = GL_RED;
-            break;
+            format         = GL_RED;
+            internalFormat = GL_R8;
+            return true;
         }
         case 3: {
-            format = GL_RGB;
-            break;
+            format         = GL_RGB;
+            internalFormat = GL_RGB8;
+            return true;
         }
         case 4: {
-            format = GL_RGBA;
-            break;
+            format         = GL_RGBA;
+            internalFormat = GL_RGBA8;
+            return true;
         }
         default: {
-            printf("Unsupported image channels: %d for image at %s\n", nChannels, path.c_str());
-            stbi_image_free(imageData);
-            return;
+            return false;
         }
     }
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, imageData);
+static int mipLevels(int width, int height) {
+    int levels = 1;
+    for (int extent = width > height ? width : height; extent > 1; extent /= 2) {
+        levels++;
+    }
+    return levels;
+}
 
+// For the bound texture
+static void setParameters(GLenum format) {
     int wrap_param = (format == GL_RGBA) ? GL_CLAMP_TO_EDGE : GL_REPEAT;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_param);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_param);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// Runs on the loader thread: decode, then upload straight from client memory
+// since blocking there costs the renderer nothing
+static unsigned int loadOnLoader(const std::string &path, int channels) {
+    int            width, height, nChannels;
+    unsigned char *imageData = stbi_load(path.c_str(), &width, &height, &nChannels, channels);
+    if (!imageData) {
+        printf("Failed to load image data from path: %s\n", path.c_str());
+        return 0;
+    }
 
+    GLenum format, internalFormat;
+    pixelFormat(channels, format, internalFormat);
+
+    unsigned int texture;
+    int          levels = mipLevels(width, height);
+    glGenTextures(1, &texture);
+    UploadManager::AllocateTexture(texture, internalFormat, width, height, levels);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, imageData);
     glGenerateMipmap(GL_TEXTURE_2D);
+    setParameters(format);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
     stbi_image_free(imageData);
+    return texture;
+}
 
-    this->id   = texture;
-    this->type = type;
-    this->path = path;
+Texture::Texture(std::string path, std::string type) {
+    this->type     = type;
+    this->path     = path;
+    this->channels = 0;
+
+    // With the loader thread only the header is read here. GetID() is 0, so
+    // draws sample black, until the texture is complete.
+    if (ResourceLoader::IsRunning()) {
+        int    width, height, nChannels;
+        GLenum format, internalFormat;
+
+        if (!stbi_info(path.c_str(), &width, &height, &nChannels)) {
+            printf("Failed to load image data from path: %s\n", path.c_str());
+            return;
+        }
+        if (!pixelFormat(nChannels, format, internalFormat)) {
+            printf("Unsupported image channels: %d for image at %s\n", nChannels, path.c_str());
+            return;
+        }
+
+        this->channels = nChannels;
+        this->id       = std::shared_ptr<unsigned int>(new unsigned int(0), deleteTexture);
+
+        std::weak_ptr<unsigned int>   target = this->id;
+        std::shared_ptr<unsigned int> loaded(new unsigned int(0));
+        auto work    = [path, nChannels, loaded]() { *loaded = loadOnLoader(path, nChannels); };
+        auto onReady = [target, loaded]() {
+            std::shared_ptr<unsigned int> id = target.lock();
+            if (id) {
+                *id = *loaded;
+            } else {
+                glDeleteTextures(1, loaded.get());
+            }
+        };
+        ResourceLoader::Queue(work, onReady);
+        return;
+    }
 
-    return;
+    TextureImage image = Decode(path);
+    create(image);
 }
 
-Texture::~Texture() {
-    glDeleteTextures(1, &this->id);
+Texture::Texture(std::string path, std::string type, TextureImage image) {
+    this->type     = type;
+    this->path     = path;
+    this->channels = 0;
+
+    create(image);
+}
+
+TextureImage Texture::Decode(const std::string &path) {
+    TextureImage image;
+    image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+
+    if (!image.pixels) {
+        printf("Failed to load image data from path: %s\n", path.c_str());
+    }
+    return image;
+}
+
+// Decoded pixels go to a staging buffer and reach the texture through
+// GPU-side copies, spread over frames by UploadScheduler. Mipmaps are
+// generated once the last rows are in.
+void Texture::create(TextureImage &image) {
+    unsigned int texture;
+    GLenum       format, internalFormat;
+
+    if (!image.pixels) {
+        return;
+    }
+
+    if (!pixelFormat(image.channels, format, internalFormat)) {
+        printf("Unsupported image channels: %d for image at %s\n", image.channels, path.c_str());
+        stbi_image_free(image.pixels);
+        return;
+    }
+
+    unsigned int staging;
+    GLintptr     offset;
+    GLsizeiptr   size   = (GLsizeiptr)image.width * image.height * image.channels;
+    void        *pixels = UploadManager::Stage(size, staging, offset);
+    if (!pixels) {
+        stbi_image_free(image.pixels);
+        return;
+    }
+    memcpy(pixels, image.pixels, size);
+    stbi_image_free(image.pixels);
+
+    int levels = mipLevels(image.width, image.height);
+    glGenTextures(1, &texture);
+    UploadManager::AllocateTexture(texture, internalFormat, image.width, image.height, levels);
+    UploadScheduler::QueueTexture(
+        staging, offset, texture, format, image.channels, image.width, image.height);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    setParameters(format);
+
+    this->channels = image.channels;
+    this->id       = std::shared_ptr<unsigned int>(new unsigned int(texture), deleteTexture);
 }
 
 unsigned int Texture::GetID() {
-    return this->id;
+    return this->id ? *this->id : 0;
 }
 
 std::string Texture::GetType() {
@@ -72,3 +194,7 @@ std::string Texture::GetType() {
 std::string Texture::GetPath() {
     return this->path;
 }
+
+bool Texture::HasAlpha() {
+    return this->channels == 4;
+}
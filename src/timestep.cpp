@@ -0,0 +1,76 @@
+#include <timestep.hpp>
+
+FixedTimestep::FixedTimestep(float rate) {
+    frequency   = SDL_GetPerformanceFrequency();
+    step        = rate > 0.0f ? (Uint64)(frequency / rate) : frequency / 60;
+    last        = SDL_GetPerformanceCounter();
+    accumulator = 0;
+    steps       = 0;
+
+    if (step == 0) {
+        step = 1;
+    }
+}
+
+void FixedTimestep::Advance() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    accumulator += now - last;
+    last = now;
+
+    if (accumulator > step * MaxSteps) {
+        accumulator = step * MaxSteps;
+    }
+}
+
+void FixedTimestep::Reset() {
+    last        = SDL_GetPerformanceCounter();
+    accumulator = 0;
+}
+
+bool FixedTimestep::Step() {
+    if (accumulator < step) {
+        return false;
+    }
+
+    accumulator -= step;
+    steps++;
+    return true;
+}
+
+float FixedTimestep::GetStep() const {
+    return (float)((double)step / frequency);
+}
+
+float FixedTimestep::GetAlpha() const {
+    return (float)((double)accumulator / step);
+}
+
+double FixedTimestep::GetTime() const {
+    return (double)steps * step / frequency;
+}
+
+FrameLimiter::FrameLimiter(float rate) {
+    frequency = SDL_GetPerformanceFrequency();
+    interval  = rate > 0.0f ? (Uint64)(frequency / rate) : 0;
+    next      = SDL_GetPerformanceCounter() + interval;
+}
+
+void FrameLimiter::Wait() {
+    if (interval == 0) {
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (now < next) {
+        Uint64 ms = (next - now) * 1000 / frequency;
+        if (ms > 1) {
+            SDL_Delay((Uint32)(ms - 1));
+        }
+        while (SDL_GetPerformanceCounter() < next) {
+        }
+    }
+
+    // A late frame starts the schedule over rather than rushing the next ones
+    now  = SDL_GetPerformanceCounter();
+    next = next + interval > now ? next + interval : now + interval;
+}
@@ -0,0 +1,225 @@
+#include <upload_manager.hpp>
+
+#include <stdio.h>
+
+std::vector<UploadManager::Staging> UploadManager::pool;
+GLsizeiptr                          UploadManager::stagedBytes = 0;
+
+void *UploadManager::Stage(GLsizeiptr size, unsigned int &staging, GLintptr &offset) {
+    const GLbitfield persistentFlags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    // The rest of an open buffer first, then the smallest idle one that fits
+    int best = -1;
+    for (unsigned int i = 0; i < pool.size() && best < 0; i++) {
+        if (pool[i].inUse && !pool[i].fence && pool[i].capacity - alignUp(pool[i].used) >= size) {
+            best = i;
+        }
+    }
+    for (unsigned int i = 0; i < pool.size(); i++) {
+        if (!pool[i].inUse && !pool[i].fence && pool[i].capacity >= size &&
+            (best < 0 || (!pool[best].inUse && pool[i].capacity < pool[best].capacity))) {
+            best = i;
+        }
+    }
+
+    if (best < 0) {
+        Staging entry;
+        entry.capacity = size > MinStagingSize ? size : MinStagingSize;
+        entry.used     = 0;
+        entry.mapped   = NULL;
+        entry.fence    = (GLsync)0;
+        entry.inUse    = false;
+
+        glGenBuffers(1, &entry.buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, entry.buffer);
+        if (isPersistent()) {
+            glBufferStorage(GL_COPY_READ_BUFFER, entry.capacity, NULL, persistentFlags);
+            entry.mapped =
+                glMapBufferRange(GL_COPY_READ_BUFFER, 0, entry.capacity, persistentFlags);
+        } else {
+            glBufferData(GL_COPY_READ_BUFFER, entry.capacity, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        pool.push_back(entry);
+        best = pool.size() - 1;
+    }
+
+    Staging &entry = pool[best];
+    GLintptr start = alignUp(entry.used);
+
+    void *memory = NULL;
+    if (isPersistent()) {
+        memory = entry.mapped ? (unsigned char *)entry.mapped + start : NULL;
+    } else {
+        // Only the new range, earlier ones may still wait for their copies.
+        // Nothing the GPU reads overlaps it, so there is no need to sync.
+        unmap(entry);
+        glBindBuffer(GL_COPY_READ_BUFFER, entry.buffer);
+        entry.mapped = glMapBufferRange(GL_COPY_READ_BUFFER,
+                                        start,
+                                        size,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                            GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        memory = entry.mapped;
+    }
+    if (!memory) {
+        printf("Failed to map a %ld byte staging buffer\n", (long)size);
+        return NULL;
+    }
+
+    entry.inUse = true;
+    entry.used  = start + size;
+    stagedBytes += size;
+    staging = best;
+    offset  = start;
+    return memory;
+}
+
+void UploadManager::CopyToBuffer(unsigned int staging,
+                                 GLintptr     stagingOffset,
+                                 unsigned int buffer,
+                                 GLintptr     offset,
+                                 GLsizeiptr   size) {
+    unmap(pool[staging]);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, pool[staging].buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingOffset, offset, size);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void UploadManager::CopyToTexture(unsigned int staging,
+                                  GLintptr     stagingOffset,
+                                  unsigned int texture,
+                                  int          level,
+                                  GLenum       format,
+                                  int          width,
+                                  int          height,
+                                  int          yOffset) {
+    unmap(pool[staging]);
+
+    GLint alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pool[staging].buffer);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    level,
+                    0,
+                    yOffset,
+                    width,
+                    height,
+                    format,
+                    GL_UNSIGNED_BYTE,
+                    (void *)stagingOffset);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+}
+
+void UploadManager::Submit(unsigned int staging) {
+    Staging &entry = pool[staging];
+
+    unmap(entry);
+    entry.inUse = false;
+    entry.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void UploadManager::Poll() {
+    unsigned int idle = 0;
+
+    for (unsigned int i = 0; i < pool.size(); i++) {
+        Staging &entry = pool[i];
+        if (entry.fence && glClientWaitSync(entry.fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+            glDeleteSync(entry.fence);
+            entry.fence = (GLsync)0;
+            entry.used  = 0;
+        }
+        if (!entry.inUse && !entry.fence) {
+            idle++;
+        }
+    }
+
+    // Drop idle buffers past the limit from the back, indices of buffers
+    // still in use have to stay valid
+    while (idle > MaxIdleStaging && !pool.empty() && !pool.back().inUse && !pool.back().fence) {
+        Staging &entry = pool.back();
+        if (isPersistent()) {
+            glBindBuffer(GL_COPY_READ_BUFFER, entry.buffer);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &entry.buffer);
+        pool.pop_back();
+        idle--;
+    }
+}
+
+void UploadManager::AllocateBuffer(unsigned int buffer, GLsizeiptr size, const void *data) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (isPersistent()) {
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, data, 0);
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void UploadManager::AllocateTexture(unsigned int texture,
+                                    GLenum       internalFormat,
+                                    int          width,
+                                    int          height,
+                                    int          levels) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    if (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage) {
+        glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+        return;
+    }
+
+    // Every level up front, same shape as immutable storage
+    GLenum format = internalFormat == GL_R8 ? GL_RED : internalFormat == GL_RGB8 ? GL_RGB : GL_RGBA;
+    for (int level = 0; level < levels; level++) {
+        glTexImage2D(
+            GL_TEXTURE_2D, level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+        width  = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+unsigned int UploadManager::GetInFlightCount() {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < pool.size(); i++) {
+        count += pool[i].fence ? 1 : 0;
+    }
+    return count;
+}
+
+GLsizeiptr UploadManager::GetStagedBytes() {
+    return stagedBytes;
+}
+
+GLintptr UploadManager::alignUp(GLintptr offset) {
+    return (offset + StagingAlignment - 1) & ~(StagingAlignment - 1);
+}
+
+bool UploadManager::isPersistent() {
+    return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+}
+
+void UploadManager::unmap(Staging &staging) {
+    if (isPersistent() || !staging.mapped) {
+        return;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, staging.buffer);
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    staging.mapped = NULL;
+}
@@ -0,0 +1,161 @@
+#include <upload_scheduler.hpp>
+
+#include <upload_manager.hpp>
+
+#include <chrono>
+
+std::map<int, std::deque<UploadScheduler::Upload>, std::greater<int>> UploadScheduler::queues;
+
+std::map<unsigned int, unsigned int> UploadScheduler::stagingUploads;
+GLsizeiptr                           UploadScheduler::bytesPerFrame = 4 * 1024 * 1024;
+float                                UploadScheduler::msPerFrame    = 2.0f;
+UploadStats                          UploadScheduler::stats         = {0, 0, 0, 0.0f, 0, 0};
+
+void UploadScheduler::SetBudget(GLsizeiptr bytesPerFrame, float msPerFrame) {
+    UploadScheduler::bytesPerFrame = bytesPerFrame;
+    UploadScheduler::msPerFrame    = msPerFrame;
+}
+
+void UploadScheduler::QueueBuffer(unsigned int staging,
+                                  GLintptr     stagingOffset,
+                                  unsigned int buffer,
+                                  GLsizeiptr   size,
+                                  Priority     priority) {
+    Upload upload;
+    upload.texture       = false;
+    upload.staging       = staging;
+    upload.stagingOffset = stagingOffset;
+    upload.target        = buffer;
+    upload.size          = size;
+    upload.done          = 0;
+    upload.format        = 0;
+    upload.rowBytes      = 0;
+    upload.width         = 0;
+    upload.height        = 0;
+
+    queue(upload, priority);
+}
+
+void UploadScheduler::QueueTexture(unsigned int staging,
+                                   GLintptr     stagingOffset,
+                                   unsigned int texture,
+                                   GLenum       format,
+                                   int          channels,
+                                   int          width,
+                                   int          height,
+                                   Priority     priority) {
+    Upload upload;
+    upload.texture       = true;
+    upload.staging       = staging;
+    upload.stagingOffset = stagingOffset;
+    upload.target        = texture;
+    upload.rowBytes      = width * channels;
+    upload.size          = (GLsizeiptr)upload.rowBytes * height;
+    upload.done          = 0;
+    upload.format        = format;
+    upload.width         = width;
+    upload.height        = height;
+
+    queue(upload, priority);
+}
+
+void UploadScheduler::Drain() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    stats.bytesLastFrame = 0;
+    stats.msLastFrame    = 0.0f;
+
+    if (stats.queuedUploads == 0) {
+        return;
+    }
+    stats.drainingFrames++;
+
+    GLsizeiptr budget = bytesPerFrame;
+
+    while (!queues.empty()) {
+        std::deque<Upload> &pending = queues.begin()->second;
+        Upload             &upload  = pending.front();
+
+        GLsizeiptr remaining = upload.size - upload.done;
+        GLsizeiptr chunk     = remaining < budget ? remaining : budget;
+
+        if (upload.texture) {
+            // Whole rows only; a frame that has copied nothing yet takes one
+            // row regardless so a tiny budget still drains
+            int rows = chunk / upload.rowBytes;
+            if (rows < 1) {
+                if (stats.bytesLastFrame > 0) {
+                    break;
+                }
+                rows = 1;
+            }
+            int firstRow = upload.done / upload.rowBytes;
+
+            chunk = (GLsizeiptr)rows * upload.rowBytes;
+            UploadManager::CopyToTexture(upload.staging,
+                                         upload.stagingOffset + upload.done,
+                                         upload.target,
+                                         0,
+                                         upload.format,
+                                         upload.width,
+                                         rows,
+                                         firstRow);
+        } else {
+            UploadManager::CopyToBuffer(upload.staging,
+                                        upload.stagingOffset + upload.done,
+                                        upload.target,
+                                        upload.done,
+                                        chunk);
+        }
+
+        upload.done += chunk;
+        budget -= chunk;
+        stats.bytesLastFrame += chunk;
+        stats.queuedBytes -= chunk;
+
+        if (upload.done >= upload.size) {
+            finish(upload);
+            pending.pop_front();
+            stats.queuedUploads--;
+            if (pending.empty()) {
+                queues.erase(queues.begin());
+            }
+        }
+
+        std::chrono::duration<float, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        stats.msLastFrame = elapsed.count();
+        if (budget <= 0 || stats.msLastFrame >= msPerFrame) {
+            break;
+        }
+    }
+
+    if (stats.queuedUploads == 0) {
+        stats.lastDrainFrames = stats.drainingFrames;
+        stats.drainingFrames  = 0;
+    }
+}
+
+UploadStats UploadScheduler::GetStats() {
+    return stats;
+}
+
+void UploadScheduler::queue(const Upload &upload, Priority priority) {
+    queues[priority].push_back(upload);
+    stagingUploads[upload.staging]++;
+
+    stats.queuedUploads++;
+    stats.queuedBytes += upload.size;
+}
+
+void UploadScheduler::finish(const Upload &upload) {
+    if (upload.texture) {
+        glBindTexture(GL_TEXTURE_2D, upload.target);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    if (--stagingUploads[upload.staging] == 0) {
+        stagingUploads.erase(upload.staging);
+        UploadManager::Submit(upload.staging);
+    }
+}
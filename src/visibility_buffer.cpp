@@ -0,0 +1,262 @@
+#include <visibility_buffer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+VisibilityBuffer::VisibilityBuffer(int width, int height)
+    : visibility(width, height, {GL_R32UI}),
+      geometryPass("shaders/visibility/geometry.vert", "shaders/visibility/geometry.frag"),
+      resolvePass("shaders/culling/fullscreen.vert", "shaders/visibility/resolve.frag") {
+    view       = glm::mat4(1.0f);
+    projection = glm::mat4(1.0f);
+
+    glGenVertexArrays(1, &vao);
+    glGenVertexArrays(1, &fullscreenVAO);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glGenTextures(1, &vertexTexture);
+    glGenTextures(1, &indexTexture);
+
+    // Only positions are needed to find the visible triangle
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The same buffers seen from the resolve pass: two RGBA32F texels per
+    // vertex (position + normal.x, normal.yz + uv) and one R32UI per index
+    glBindTexture(GL_TEXTURE_BUFFER, vertexTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, vbo);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, ebo);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+VisibilityBuffer::~VisibilityBuffer() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteVertexArrays(1, &fullscreenVAO);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteTextures(1, &vertexTexture);
+    glDeleteTextures(1, &indexTexture);
+    glDeleteProgram(geometryPass.ID);
+    glDeleteProgram(resolvePass.ID);
+}
+
+unsigned int VisibilityBuffer::Add(Model &model) {
+    unsigned int object = transforms.size();
+    transforms.push_back(glm::mat4(1.0f));
+
+    vector<Mesh> &meshes = model.GetMeshes();
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        if (draws.size() == MaxDraws) {
+            printf("Visibility buffer: more than %u draws, skipping the rest\n", MaxDraws);
+            break;
+        }
+        if (meshes[i].indices.size() / 3 > MaxTriangles) {
+            printf("Visibility buffer: mesh with more than %u triangles skipped\n", MaxTriangles);
+            continue;
+        }
+
+        Draw draw;
+        draw.mesh       = &meshes[i];
+        draw.object     = object;
+        draw.firstIndex = indices.size();
+        draw.indexCount = meshes[i].indices.size();
+        draw.baseVertex = vertices.size();
+        draws.push_back(draw);
+
+        vertices.insert(vertices.end(), meshes[i].vertices.begin(), meshes[i].vertices.end());
+        indices.insert(indices.end(), meshes[i].indices.begin(), meshes[i].indices.end());
+    }
+
+    upload();
+    return object;
+}
+
+void VisibilityBuffer::SetTransform(unsigned int object, const glm::mat4 &model) {
+    transforms[object] = model;
+}
+
+void VisibilityBuffer::Resize(int width, int height) {
+    visibility.Resize(width, height);
+}
+
+void VisibilityBuffer::DrawGeometry(const glm::mat4 &view, const glm::mat4 &projection) {
+    this->view       = view;
+    this->projection = projection;
+
+    GLuint empty[] = {0xFFFFFFFF, 0, 0, 0};
+
+    visibility.Bind();
+    glClearBufferuiv(GL_COLOR, 0, empty);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    geometryPass.use();
+    glBindVertexArray(vao);
+    for (unsigned int i = 0; i < draws.size(); i++) {
+        const Draw &draw = draws[i];
+
+        geometryPass.setMat4("mvp", projection * view * transforms[draw.object]);
+        glUniform1ui(glGetUniformLocation(geometryPass.ID, "drawID"), i);
+        glDrawElementsBaseVertex(GL_TRIANGLES,
+                                 draw.indexCount,
+                                 GL_UNSIGNED_INT,
+                                 (void *)(draw.firstIndex * sizeof(unsigned int)),
+                                 draw.baseVertex);
+    }
+    glBindVertexArray(0);
+}
+
+void VisibilityBuffer::Resolve(Framebuffer &target, const glm::vec3 &viewPos) {
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend     = glIsEnabled(GL_BLEND);
+    GLboolean cullFace  = glIsEnabled(GL_CULL_FACE);
+
+    int width  = visibility.GetWidth();
+    int height = visibility.GetHeight();
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, visibility.GetID());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.GetID());
+    glBlitFramebuffer(0,
+                      0,
+                      width,
+                      height,
+                      0,
+                      0,
+                      target.GetWidth(),
+                      target.GetHeight(),
+                      GL_DEPTH_BUFFER_BIT,
+                      GL_NEAREST);
+    target.Bind();
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_SCISSOR_TEST);
+
+    // Material textures take the low units, the visibility data sits above
+    unsigned int textures[] = {visibility.GetColor(0), vertexTexture, indexTexture};
+    GLenum       targets[]  = {GL_TEXTURE_2D, GL_TEXTURE_BUFFER, GL_TEXTURE_BUFFER};
+    const char  *names[]    = {"visibility", "vertices", "indices"};
+
+    resolvePass.use();
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE5 + i);
+        glBindTexture(targets[i], textures[i]);
+        resolvePass.setInt(names[i], 5 + i);
+    }
+    resolvePass.setVec2("viewportSize", (float)width, (float)height);
+    resolvePass.setVec3("viewPos", viewPos);
+
+    // One pass per draw limited to its screen rectangle; pixels owned by
+    // another draw are discarded before any vertex fetch or shading
+    glBindVertexArray(fullscreenVAO);
+    for (unsigned int i = 0; i < draws.size(); i++) {
+        const Draw &draw = draws[i];
+        int         rect[4];
+
+        if (!scissorRect(draw, rect)) {
+            continue;
+        }
+        glScissor(rect[0], rect[1], rect[2], rect[3]);
+
+        draw.mesh->BindTextures(resolvePass);
+        resolvePass.setMat4("model", transforms[draw.object]);
+        resolvePass.setMat4("mvp", projection * view * transforms[draw.object]);
+        glUniform1ui(glGetUniformLocation(resolvePass.ID, "drawID"), i);
+        glUniform1ui(glGetUniformLocation(resolvePass.ID, "firstIndex"), draw.firstIndex);
+        glUniform1ui(glGetUniformLocation(resolvePass.ID, "baseVertex"), draw.baseVertex);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glBindVertexArray(0);
+
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE5 + i);
+        glBindTexture(targets[i], 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glDisable(GL_SCISSOR_TEST);
+    glDepthMask(GL_TRUE);
+
+    if (depthTest) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+    if (cullFace) {
+        glEnable(GL_CULL_FACE);
+    }
+}
+
+Shader &VisibilityBuffer::GetResolveShader() {
+    return resolvePass;
+}
+
+void VisibilityBuffer::upload() {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER,
+                 vertices.size() * sizeof(Vertex),
+                 vertices.data(),
+                 GL_STATIC_DRAW);
+
+    // Bound through GL_ARRAY_BUFFER so the VAO's element binding is untouched
+    glBindBuffer(GL_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ARRAY_BUFFER,
+                 indices.size() * sizeof(unsigned int),
+                 indices.data(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool VisibilityBuffer::scissorRect(const Draw &draw, int rect[4]) {
+    int       width  = visibility.GetWidth();
+    int       height = visibility.GetHeight();
+    glm::mat4 mvp    = projection * view * transforms[draw.object];
+
+    float minX = width, minY = height;
+    float maxX = 0.0f, maxY = 0.0f;
+
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 c = mvp * glm::vec4(draw.mesh->bounds.Corner(i), 1.0f);
+
+        // Reaches behind the camera, fall back to the whole screen
+        if (c.w <= 0.0f) {
+            rect[0] = 0;
+            rect[1] = 0;
+            rect[2] = width;
+            rect[3] = height;
+            return true;
+        }
+
+        float x = (c.x / c.w * 0.5f + 0.5f) * width;
+        float y = (c.y / c.w * 0.5f + 0.5f) * height;
+
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+    }
+
+    int x0 = std::max(0, (int)std::floor(minX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int x1 = std::min(width, (int)std::ceil(maxX));
+    int y1 = std::min(height, (int)std::ceil(maxY));
+
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+
+    rect[0] = x0;
+    rect[1] = y0;
+    rect[2] = x1 - x0;
+    rect[3] = y1 - y0;
+    return true;
+}
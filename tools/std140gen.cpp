@@ -0,0 +1,343 @@
+// Build-time generator: reads GLSL sources, finds every
+//
+//     layout (std140) uniform Name { ... };
+//
+// block and writes a header with a C++ struct per block whose members sit
+// at the std140 offsets, checked with static_assert. Run by CMake, see
+// CMakeLists.txt:
+//
+//     std140gen <output.hpp> <shader files...>
+//
+// Members may be scalars, vectors, mat3/mat4 and arrays of those. Nested
+// structs are not supported. A block declared in several files (usually
+// through an #include) must have the same members everywhere.
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct Type {
+    const char  *glsl;
+    const char  *cpp;
+    unsigned int size, align;
+    // Array elements and matrix columns are padded to a vec4 in std140
+    const char *arrayCpp;
+};
+
+static const Type types[] = {
+    {"float", "float", 4, 4, "glm::vec4"},
+    {"int", "int", 4, 4, "glm::ivec4"},
+    {"uint", "unsigned int", 4, 4, "glm::uvec4"},
+    {"bool", "int", 4, 4, "glm::ivec4"},
+    {"vec2", "glm::vec2", 8, 8, "glm::vec4"},
+    {"ivec2", "glm::ivec2", 8, 8, "glm::ivec4"},
+    {"uvec2", "glm::uvec2", 8, 8, "glm::uvec4"},
+    {"vec3", "glm::vec3", 12, 16, "glm::vec4"},
+    {"ivec3", "glm::ivec3", 12, 16, "glm::ivec4"},
+    {"uvec3", "glm::uvec3", 12, 16, "glm::uvec4"},
+    {"vec4", "glm::vec4", 16, 16, "glm::vec4"},
+    {"ivec4", "glm::ivec4", 16, 16, "glm::ivec4"},
+    {"uvec4", "glm::uvec4", 16, 16, "glm::uvec4"},
+    {"mat3", "glm::mat3x4", 48, 16, "glm::mat3x4"},
+    {"mat4", "glm::mat4", 64, 16, "glm::mat4"},
+};
+
+struct Member {
+    const Type  *type;
+    std::string  name;
+    unsigned int count; // 0 when not an array
+    unsigned int offset;
+};
+
+struct Block {
+    std::string         name;
+    std::string         file;
+    std::vector<Member> members;
+    unsigned int        size;
+};
+
+static const Type *findType(const std::string &name) {
+    for (unsigned int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (name == types[i].glsl) {
+            return &types[i];
+        }
+    }
+    return NULL;
+}
+
+static unsigned int alignUp(unsigned int value, unsigned int align) {
+    return (value + align - 1) / align * align;
+}
+
+static std::string readFile(const char *path) {
+    std::ifstream file(path);
+    if (!file) {
+        return "";
+    }
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+// Comments out of the way so the tokenizer only sees declarations
+static std::string stripComments(const std::string &code) {
+    std::string result;
+
+    for (std::string::size_type i = 0; i < code.size(); i++) {
+        if (code.compare(i, 2, "//") == 0) {
+            i = code.find('\n', i);
+            if (i == std::string::npos) {
+                break;
+            }
+        } else if (code.compare(i, 2, "/*") == 0) {
+            i = code.find("*/", i);
+            if (i == std::string::npos) {
+                break;
+            }
+            i++;
+            continue;
+        }
+        result += code[i];
+    }
+
+    return result;
+}
+
+static std::vector<std::string> tokenize(const std::string &code) {
+    std::vector<std::string> tokens;
+    std::string              token;
+
+    for (std::string::size_type i = 0; i < code.size(); i++) {
+        char c = code[i];
+        if (isalnum((unsigned char)c) || c == '_' || c == '#') {
+            token += c;
+            continue;
+        }
+        if (!token.empty()) {
+            tokens.push_back(token);
+            token.clear();
+        }
+        if (!isspace((unsigned char)c)) {
+            tokens.push_back(std::string(1, c));
+        }
+    }
+    if (!token.empty()) {
+        tokens.push_back(token);
+    }
+
+    return tokens;
+}
+
+static bool parseBlocks(const char *path, std::vector<Block> &blocks) {
+    std::vector<std::string> tokens = tokenize(stripComments(readFile(path)));
+
+    for (unsigned int i = 0; i + 6 < tokens.size(); i++) {
+        // layout ( std140 ) uniform Name {
+        if (tokens[i] != "layout" || tokens[i + 1] != "(" || tokens[i + 2] != "std140" ||
+            tokens[i + 3] != ")" || tokens[i + 4] != "uniform" || tokens[i + 6] != "{") {
+            continue;
+        }
+
+        Block block;
+        block.name = tokens[i + 5];
+        block.file = path;
+        block.size = 0;
+
+        unsigned int t = i + 7;
+        while (t < tokens.size() && tokens[t] != "}") {
+            // Precision and layout qualifiers on members do not change std140
+            while (t < tokens.size() &&
+                   (tokens[t] == "highp" || tokens[t] == "mediump" || tokens[t] == "lowp")) {
+                t++;
+            }
+            if (t + 2 >= tokens.size()) {
+                break;
+            }
+
+            Member member;
+            member.type  = findType(tokens[t]);
+            member.name  = tokens[t + 1];
+            member.count = 0;
+            if (!member.type) {
+                printf("%s: unsupported type '%s' in block %s\n",
+                       path,
+                       tokens[t].c_str(),
+                       block.name.c_str());
+                return false;
+            }
+            t += 2;
+
+            if (tokens[t] == "[") {
+                member.count = atoi(tokens[t + 1].c_str());
+                if (member.count == 0 || tokens[t + 2] != "]") {
+                    printf("%s: array size of %s must be a literal\n", path, member.name.c_str());
+                    return false;
+                }
+                t += 3;
+            }
+            if (t >= tokens.size() || tokens[t] != ";") {
+                printf("%s: expected ';' after %s\n", path, member.name.c_str());
+                return false;
+            }
+            t++;
+
+            // Arrays round each element up to a vec4
+            unsigned int align = member.count > 0 ? 16 : member.type->align;
+            unsigned int size  = member.count > 0 ? alignUp(member.type->size, 16) * member.count
+                                                  : member.type->size;
+
+            member.offset = alignUp(block.size, align);
+            block.size    = member.offset + size;
+            block.members.push_back(member);
+        }
+
+        // The block's size is rounded up to its largest alignment
+        block.size = alignUp(block.size, 16);
+        blocks.push_back(block);
+        i = t;
+    }
+
+    return true;
+}
+
+static bool sameLayout(const Block &a, const Block &b) {
+    if (a.members.size() != b.members.size()) {
+        return false;
+    }
+    for (unsigned int i = 0; i < a.members.size(); i++) {
+        if (a.members[i].type != b.members[i].type || a.members[i].name != b.members[i].name ||
+            a.members[i].count != b.members[i].count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writeBlock(std::ostream &out, const Block &block, unsigned int binding) {
+    out << "// " << block.file << "\n";
+    out << "struct " << block.name << "Block {\n";
+    out << "    static constexpr const char  *Name    = \"" << block.name << "\";\n";
+    out << "    static constexpr unsigned int Binding = " << binding << ";\n\n";
+
+    unsigned int offset = 0, pad = 0;
+    for (unsigned int i = 0; i < block.members.size(); i++) {
+        const Member &member = block.members[i];
+        if (member.offset > offset) {
+            out << "    float _pad" << pad++ << "[" << (member.offset - offset) / 4 << "];\n";
+        }
+
+        if (member.count > 0) {
+            out << "    " << member.type->arrayCpp << " " << member.name << "[" << member.count
+                << "];\n";
+            offset = member.offset + alignUp(member.type->size, 16) * member.count;
+        } else {
+            out << "    " << member.type->cpp << " " << member.name << ";\n";
+            offset = member.offset + member.type->size;
+        }
+    }
+    if (block.size > offset) {
+        out << "    float _pad" << pad++ << "[" << (block.size - offset) / 4 << "];\n";
+    }
+
+    out << "\n";
+    out << "    // Whole block in one call, buffer must hold at least sizeof(*this)\n";
+    out << "    void upload(unsigned int buffer, GLintptr offset = 0) const {\n";
+    out << "        glBindBuffer(GL_UNIFORM_BUFFER, buffer);\n";
+    out << "        glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(*this), this);\n";
+    out << "    }\n\n";
+    out << "    // For persistently mapped buffers\n";
+    out << "    void upload(void *mapped) const {\n";
+    out << "        memcpy(mapped, this, sizeof(*this));\n";
+    out << "    }\n";
+    out << "};\n\n";
+
+    for (unsigned int i = 0; i < block.members.size(); i++) {
+        const Member &member = block.members[i];
+        out << "static_assert(offsetof(" << block.name << "Block, " << member.name
+            << ") == " << member.offset << ", \"std140 offset of " << block.name << "."
+            << member.name << "\");\n";
+    }
+    out << "static_assert(sizeof(" << block.name << "Block) == " << block.size
+        << ", \"std140 size of " << block.name << "\");\n\n";
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s <output.hpp> <shader files...>\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Block> blocks;
+    for (int i = 2; i < argc; i++) {
+        std::vector<Block> found;
+        if (!parseBlocks(argv[i], found)) {
+            return 1;
+        }
+
+        for (unsigned int b = 0; b < found.size(); b++) {
+            bool known = false;
+            for (unsigned int k = 0; k < blocks.size() && !known; k++) {
+                if (blocks[k].name != found[b].name) {
+                    continue;
+                }
+                if (!sameLayout(blocks[k], found[b])) {
+                    printf("Uniform block %s differs between %s and %s\n",
+                           found[b].name.c_str(),
+                           blocks[k].file.c_str(),
+                           found[b].file.c_str());
+                    return 1;
+                }
+                known = true;
+            }
+            if (!known) {
+                blocks.push_back(found[b]);
+            }
+        }
+    }
+
+    std::ostringstream out;
+    out << "// Generated by tools/std140gen.cpp from the shaders' uniform blocks, do not edit\n\n";
+    out << "#ifndef UNIFORM_BLOCKS_H\n#define UNIFORM_BLOCKS_H\n\n";
+    out << "#include <cstddef>\n#include <cstring>\n\n";
+    out << "#include <glad/glad.h>\n#include <glm.hpp>\n\n";
+
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        writeBlock(out, blocks[i], i);
+    }
+
+    out << "// Points every generated block the program declares at its binding, needed\n";
+    out << "// after each link since GLSL 330 has no layout(binding)\n";
+    out << "inline void BindUniformBlocks(unsigned int program) {\n";
+    if (!blocks.empty()) {
+        out << "    const char *names[] = {";
+        for (unsigned int i = 0; i < blocks.size(); i++) {
+            out << (i > 0 ? ", " : "") << blocks[i].name << "Block::Name";
+        }
+        out << "};\n\n";
+        out << "    for (unsigned int i = 0; i < " << blocks.size() << "; i++) {\n";
+        out << "        unsigned int index = glGetUniformBlockIndex(program, names[i]);\n";
+        out << "        if (index != GL_INVALID_INDEX) {\n";
+        out << "            glUniformBlockBinding(program, index, i);\n";
+        out << "        }\n";
+        out << "    }\n";
+    } else {
+        out << "    (void)program;\n";
+    }
+    out << "}\n\n";
+    out << "#endif // UNIFORM_BLOCKS_H\n";
+
+    // Always written so the build sees it as fresh; CMake copies it over the
+    // real header only when the contents changed
+    std::ofstream file(argv[1]);
+    if (!file) {
+        printf("Failed to write %s\n", argv[1]);
+        return 1;
+    }
+    file << out.str();
+
+    return 0;
+}